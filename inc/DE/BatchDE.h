@@ -0,0 +1,68 @@
+#pragma once
+#include "DEConfig.h"
+#include <vector>
+#include <functional>
+#include <random>
+#include <cstdint>
+
+// Objective of BatchDE: scores one candidate of each of the problems begin .. begin + count - 1.
+// Coordinate j of problem begin + l is xs[j * stride + l]; fom[l] and violation[l] (total constraint
+// violation, 0 when feasible) receive its results. Called concurrently for disjoint problem blocks
+typedef std::function<void(size_t begin, size_t count, const Scalar* xs, size_t stride, double* fom,
+                           double* violation)>
+    LaneObjective;
+
+// Many small independent problems of the same dimension solved at once. The problems are split in
+// blocks of `lanes`, one OpenMP thread per block, and every block is stored structure-of-arrays:
+// coordinate j of individual i of all the problems of the block is one contiguous row of lanes, so
+// mutation, crossover and selection are plain loops over the lanes. The problems of a block share
+// the donor indices and the crossover masks, each problem still follows a valid DE (best1 draws a
+// difference of its own for the lanes whose best the shared one contains); the random
+// numbers of a block come from its own engine, so a seeded run doesn't depend on the threads.
+// Supported: rand1 and best1 mutation, bin and exp crossover, static penalty and feasibility rule
+// selection, with F, CR, NP, max_iter and seed of the config
+class BatchDE
+{
+public:
+    static const size_t lanes = 64;
+    BatchDE(LaneObjective, size_t num_problems, const Ranges&, const DEConfig&);
+    BatchDE(LaneObjective, const std::vector<Ranges>& ranges, const DEConfig&); // ranges of every problem
+    void solver();
+
+    size_t num_problems() const noexcept { return _n; }
+    size_t dimension() const noexcept { return _dim; }
+    size_t curr_gen() const noexcept { return _curr_gen; }
+    size_t evaluations() const noexcept { return _evaluations; }
+    Solution best(size_t problem) const;
+    double best_fom(size_t problem) const;
+    double best_violation(size_t problem) const;
+
+private:
+    struct Block
+    {
+        size_t begin = 0;
+        size_t count = 0;
+        std::mt19937_64 engine;
+        // [i][j][lane] rows, `lanes` wide whatever `count`
+        std::vector<Scalar> x, trial, lb, ub, base;
+        std::vector<double> fom, violation, trial_fom, trial_violation; // [i][lane]
+        std::vector<size_t> best;                                       // [lane]
+        std::vector<size_t> d1, d2;  // best1 difference of the lanes whose best the shared one hit, [lane]
+        std::vector<size_t> redrawn; // those lanes
+        std::vector<char> mask;                                         // crossover, [j]
+        std::vector<char> won;                                          // selection, [lane]
+    };
+    const LaneObjective _func;
+    const DEConfig _conf;
+    const size_t _n;
+    const size_t _dim;
+    std::vector<Block> _blocks;
+    size_t _curr_gen;
+    size_t _evaluations;
+
+    void _init(Block&);
+    void _generation(Block&);
+    void _evaluate(Block&, const std::vector<Scalar>& xs, std::vector<double>& fom, std::vector<double>& violation);
+    void _update_best(Block&);
+    bool _better(double f1, double v1, double f2, double v2) const noexcept;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include "DEOrigin.h"
+#include <vector>
+#include <memory>
+#include <iostream>
+
+// Cooperative coevolution for large-scale problems: the variables are split into groups, randomly
+// or by differential grouping (DG2-style pairwise probes, evaluated in parallel on the shared thread
+// pool by at most NP slots, the slot being the objective index, so interacting variables share a
+// group). Every group is optimized by its own DE, DERandomF or SaDE sub-population over its
+// variables only, the others being taken from a shared context vector. In every cycle all
+// sub-populations run `cc_generations` generations concurrently on the thread pool against the same
+// context, then the context takes the best of the merged group bests and every single group best,
+// ordered by (total violation, FOM). Sub-populations carry over to the next cycle and are
+// re-evaluated against the new context. Index i of group g is evaluated with the objective index
+// g * S + i, S being DE::slots() of a sub-population (NP, plus `ls_top_k` with local search), so the
+// indices stay below `slots()` and no two concurrent evaluations share one; the probes and the
+// context evaluations use indices below NP
+class Coevolution
+{
+public:
+    // the sub-populations use the strategies, F, CR, NP and the other keys of `conf`, with
+    // `cc_generations` generations per cycle and the work-stealing schedule
+    Coevolution(Objective, const Ranges&, const DEConfig&);
+    ~Coevolution();
+    Coevolution(const Coevolution&) = delete;
+    Coevolution& operator=(const Coevolution&) = delete;
+    Solution solver();
+
+    const std::vector<std::vector<size_t>>& groups() const noexcept { return _groups; }
+    const Solution& best() const noexcept { return _context; }
+    const Evaluated& best_result() const noexcept { return _context_result; }
+    const std::vector<double>& curve() const noexcept { return _curve; } // best FOM after every cycle
+    size_t evaluations() const noexcept;
+    size_t grouping_evaluations() const noexcept { return _grouping_evals; }
+    size_t slots() const noexcept { return _groups.size() * _slots; } // bound of the objective indices
+    void set_log(std::ostream* log) noexcept { _log = log; }
+    void report(std::ostream&) const;
+
+private:
+    const Objective _func;
+    const Ranges _ranges;
+    const DEConfig _conf;
+    std::vector<std::vector<size_t>> _groups;
+    std::vector<std::unique_ptr<DE>> _subs;
+    Solution _context; // read concurrently by the sub-populations, written between cycles only
+    Evaluated _context_result;
+    size_t _version;   // of the context, invalidates the thread-local copies
+    size_t _slots;     // objective indices per sub-population, DE::slots()
+    std::vector<double> _curve;
+    size_t _grouping_evals;
+    size_t _context_evals;
+    std::ostream* _log;
+
+    void _random_grouping();
+    void _differential_grouping();
+    Evaluated _evaluate_group(size_t g, size_t i, const Solution& y) const;
+    void _cycle(size_t c);
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include "strategy/DEInterface.h"
+#include "EvalScheduler.h"
+#include <string>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+class ConfigError : public std::runtime_error
+{
+public:
+    explicit ConfigError(const std::string& what) : std::runtime_error(what) {}
+};
+enum DEVariant
+{
+    Origin = 0,
+    RandomF,
+    SelfAdaptive
+};
+const std::unordered_map<std::string, DEVariant> dv_lut{{"de", Origin}, {"randomf", RandomF}, {"sade", SelfAdaptive}};
+enum LocalSearchMethod
+{
+    NelderMead = 0,
+    QuasiNewton // bounded BFGS with forward finite differences
+};
+const std::unordered_map<std::string, LocalSearchMethod> ls_lut{{"nelder-mead", NelderMead},
+                                                                {"quasi-newton", QuasiNewton}};
+// how Coevolution splits the variables
+enum GroupingMethod
+{
+    RandomGrouping = 0,
+    DifferentialGrouping // pairwise interaction probes, interacting variables share a group
+};
+const std::unordered_map<std::string, GroupingMethod> gm_lut{{"random", RandomGrouping},
+                                                             {"differential", DifferentialGrouping}};
+// which low fidelity trials are re-evaluated at high fidelity, see DE::set_multi_fidelity_objective
+enum PromotionPolicy
+{
+    PromoteWinners = 0, // trials that beat their targets at low fidelity
+    PromoteTop,         // the best `mf_top_fraction` of the trials at low fidelity
+    PromoteEither       // both
+};
+const std::unordered_map<std::string, PromotionPolicy> pp_lut{
+    {"winners", PromoteWinners}, {"top", PromoteTop}, {"either", PromoteEither}};
+
+struct EpsilonConfig
+{
+    bool given   = false; // theta, cp and tc are all required by the epsilon selector
+    double theta = 0;
+    double cp    = 0;
+    size_t tc    = 0;
+};
+struct SaDEConfig
+{
+    bool given     = false; // lp, fmu, fsigma, crmu and crsigma are all required by SaDE
+    size_t lp      = 0;
+    double fmu     = 0;
+    double fsigma  = 0;
+    double crmu    = 0;
+    double crsigma = 0;
+};
+struct SurrogateConfig
+{
+    bool enabled       = false;
+    size_t k           = 5;
+    double explore     = 0.1;
+    size_t min_archive = 0; // 0: 2 * np
+    size_t max_archive = 0; // 0: 20 * np
+};
+struct RepairConfig
+{
+    double prob    = 0; // 0: disabled
+    size_t steps   = 3;
+    double fd_step = 1e-6;
+};
+struct RestartConfig
+{
+    size_t max_restarts = 0;     // 0: no restart
+    double growth       = 2;     // NP multiplier of every restart
+    size_t stall        = 30;    // generations without improvement of the best
+    double tol          = 1e-12; // relative improvement, and relative FOM spread of a converged population
+    size_t max_np       = 0;     // 0: unlimited
+    size_t budget       = 0;     // evaluations shared by all restarts, 0: unlimited
+};
+struct LocalSearchConfig
+{
+    bool enabled             = false;
+    LocalSearchMethod method = NelderMead;
+    size_t period            = 10;    // generations between two launches, a job runs until the next one
+    size_t top_k             = 1;     // best individuals refined per launch, one thread each
+    size_t max_evals         = 0;     // per refined point, 0: 50 * dim
+    double share             = 0.2;   // largest fraction of all evaluations spent by local search
+    double fd_step           = 1e-6;  // relative to the width of each range
+    double tol               = 1e-10; // relative
+};
+struct FidelityConfig
+{
+    PromotionPolicy promotion = PromoteEither;
+    double top_fraction       = 0.1; // of the trials of a generation
+    double margin             = 0;   // winners: FOM slack relative to the target FOM, for a biased low fidelity
+};
+struct CoevolutionConfig
+{
+    GroupingMethod grouping = RandomGrouping;
+    size_t group_size       = 100;   // of the random groups, and bound of the packed separable variables
+    size_t cycles           = 10;
+    size_t generations      = 20;    // of every sub-population in a cycle
+    double dg_epsilon       = 1e-10; // interaction threshold, relative to the probed FOM magnitudes
+};
+struct EigenConfig
+{
+    size_t period  = 5;   // generations between two refreshes of the eigenbasis
+    double prob    = 1;   // of a trial crossed in the eigenbasis, the others are crossed coordinate-wise
+    size_t max_dim = 500; // above it the crossover is plain bin, the covariance being O(dim^2)
+};
+
+// All runtime parameters, resolved and validated once. The keys of the legacy
+// `extra_conf` map and of config files are:
+//     variant, mutation, crossover, selection, schedule (names from the *_lut tables)
+//     f, fsigma, cr, np, max_iter, min_valid_num, seed, eval_schedule, eval_chunk
+//     numa, numa_threads
+//     theta, cp, tc                          (epsilon selector)
+//     lp, fmu, fsigma, crmu, crsigma         (SaDE)
+//     surrogate, surrogate_k, surrogate_explore, surrogate_min_archive, surrogate_max_archive
+//     repair_prob, repair_steps, repair_fd_step
+//     restarts, restart_growth, restart_stall, restart_tol, restart_max_np, budget
+//     local_search (method, enables it), ls_period, ls_top_k, ls_evals, ls_share, ls_fd_step, ls_tol
+//     mf_promotion, mf_top_fraction, mf_margin
+//     cc_grouping, cc_group_size, cc_cycles, cc_generations, cc_epsilon (Coevolution)
+//     eig_period, eig_prob, eig_max_dim      (eigen crossover)
+// other numeric keys are kept in `extra` for user-defined strategies
+struct DEConfig
+{
+    DEVariant variant    = Origin;
+    MutationStrategy ms  = Best1;
+    CrossoverStrategy cs = Bin;
+    SelectionStrategy ss = StaticPenalty;
+    double f             = 0.8;
+    double fsigma        = 0; // standard deviation of F in DERandomF
+    double cr            = 0.8;
+    size_t np            = 100;
+    size_t max_iter      = 200;
+    size_t min_valid_num = 1;
+    bool seeded          = false;
+    uint64_t seed        = 0;
+    SchedulePolicy schedule = OmpStatic;
+    size_t eval_chunk       = 1;
+    bool numa               = false; // NUMA mode of DE::solver, see DE::enable_numa
+    size_t numa_threads     = 0;     // 0: omp_get_max_threads()
+    EpsilonConfig epsilon;
+    SaDEConfig sade;
+    SurrogateConfig surrogate;
+    RepairConfig repair;
+    RestartConfig restart;
+    LocalSearchConfig local_search;
+    FidelityConfig fidelity;
+    CoevolutionConfig coevolution;
+    EigenConfig eigen;
+    std::unordered_map<std::string, double> extra;
+
+    // throw ConfigError on the first invalid or missing parameter
+    void validate() const;
+
+    static DEConfig from_map(const std::unordered_map<std::string, double>&);
+    static DEConfig from_strings(const std::unordered_map<std::string, std::string>&);
+    static DEConfig from_file(const std::string& path);
+    // `key = value` lines, `#` starts a comment
+    static std::unordered_map<std::string, std::string> read_file(const std::string& path);
+};
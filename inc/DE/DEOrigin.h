@@ -1,15 +1,66 @@
 #pragma once
 #include "strategy/DEInterface.h"
 #include "strategy/DEBuiltInStrategy.h"
+#include "EvalScheduler.h"
+#include "DEConfig.h"
+#include "Surrogate.h"
+#include "GradientRepair.h"
+#include "Numa.h"
+#include "LocalSearch.h"
+#include "Metrics.h"
+#include "EvalCache.h"
+#include <memory>
+#include <functional>
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+#include <random>
+class DE;
+// called after every generation, return false to stop the solver
+typedef std::function<bool(const DE&)> GenerationCallback;
+// trials evaluated through the staged objective, and those whose figure of merit was skipped
+struct StagedStats
+{
+    size_t trials  = 0;
+    size_t skipped = 0;
+    void report(std::ostream&) const;
+};
+enum Fidelity
+{
+    LowFidelity = 0,
+    HighFidelity,
+    NumFidelities
+};
+// cost spent at each fidelity of a multi-fidelity objective, and the trials promoted to high fidelity
+struct FidelityStats
+{
+    size_t trials                      = 0;
+    size_t promoted                    = 0;
+    size_t evaluations[NumFidelities]  = {0, 0};
+    double seconds[NumFidelities]      = {0, 0}; // summed over the evaluating threads
+    void report(std::ostream&) const;
+};
 class DE {
 protected:
     Objective _func;
+    BatchObjective _batch_func;
+    ConstraintFunction _staged_constraints;
+    FomFunction _staged_fom;
+    StagedStats _staged_stats;
+    Objective _low_func;
+    FidelityConfig _fidelity;
+    size_t _fidelity_trials;
+    size_t _fidelity_promoted;
+    std::atomic<size_t> _fidelity_evals[NumFidelities];
+    std::atomic<uint64_t> _fidelity_ns[NumFidelities];
+    IncrementalObjective _incremental_func;
     const Ranges _ranges;
+    const DEConfig _conf;
     const double _f;
     const double _cr;
-    const size_t _np;
+    size_t _np;       // changed by `reinitialize` only
     const size_t _dim;
-    const size_t _max_iter;
+    size_t _max_iter;
     const std::unordered_map<std::string, double> _extra_conf;
     size_t _curr_gen;
     std::vector<Solution> _population; // use vector to represent a 2D matrix might not be efficient
@@ -18,13 +69,83 @@ protected:
     ICrossover* _crossover;
     ISelector*  _selector;
     bool _use_built_in_strategy;
+    EvalScheduler _scheduler;
+    EvalScheduler _low_scheduler; // low fidelity, same policy, its latencies and predictions apart
+    std::unique_ptr<SurrogateScreen> _surrogate;
+    std::unique_ptr<GradientRepair> _repair;
+    std::unique_ptr<NumaTeam> _numa;
+    std::unique_ptr<LocalSearch> _local_search; // after `_scheduler`, its jobs count into it
+    Metrics _metrics;
+    std::unique_ptr<EvalCache> _cache;
+    // generation arena, sized by `init` and reused by every generation; in NUMA mode the rows
+    // are first touched by their owner threads
+    std::vector<Solution> _doners;
+    std::vector<Solution> _trials;
+    std::vector<Evaluated> _trial_results;
+    std::vector<SparseTrial> _sparse_trials;
+    std::vector<size_t> _all; // 0 .. NP-1
+    // trials evaluated at full fidelity by the last `evaluate_trials`, the others hold their targets
+    std::vector<char> _kept;     // [np]
+    std::vector<size_t> _full;   // their indices
+    std::vector<Solution> _initial; // consumed by the next `init`
+    std::ostream* _log;
+    bool _seeded;
+    uint64_t _seed;
+    GenerationCallback _on_generation;
+    bool _stopped;                  // by the generation callback, `resume` continues the run
+    std::mt19937_64 _stopped_engine; // random engine of the solver thread at the stop
 
-    virtual IMutator*   set_mutator(MutationStrategy, const std::unordered_map<std::string, double>&)    const noexcept;
-    virtual ICrossover* set_crossover(CrossoverStrategy, const std::unordered_map<std::string, double>&) const noexcept;
-    virtual ISelector*  set_selector(SelectionStrategy, const std::unordered_map<std::string, double>&)  const noexcept;
+    // throw ConfigError for unrecognized strategies
+    virtual IMutator*   set_mutator(MutationStrategy, const DEConfig&)    const;
+    virtual ICrossover* set_crossover(CrossoverStrategy, const DEConfig&) const;
+    virtual ISelector*  set_selector(SelectionStrategy, const DEConfig&)  const;
     virtual void init();
+    // the generation loop of `solver` and `resume`, from `_curr_gen` on
+    virtual Solution evolve();
+    // evaluate all solutions in parallel with the configured schedule policy
+    virtual void evaluate(const std::vector<Solution>&, std::vector<Evaluated>&);
+    // evaluate only the solutions listed in the index vector
+    virtual void evaluate(const std::vector<Solution>&, std::vector<Evaluated>&, const std::vector<size_t>&);
+    // one point outside of a batch (sparse trials, local search), through the cache if any, always
+    // with the point objective: it may run concurrently with a batch, which the batch objective forbids
+    Evaluated objective(size_t i, const Solution& x);
+    // evaluate the listed trials against their targets, with a staged objective the figure of
+    // merit of the trials that can't win is skipped and set to +inf. With a multi-fidelity
+    // objective the trials that aren't promoted to high fidelity are replaced by their targets;
+    // `_kept` and `_full` tell the trials really evaluated, the only ones to learn from
+    virtual void evaluate_trials(std::vector<Solution>& trials, std::vector<Evaluated>& results,
+                                 const std::vector<size_t>& which);
+    // the listed trials to evaluate at high fidelity, given their low fidelity results
+    virtual std::vector<size_t> promote(const std::vector<Evaluated>& low_results, const std::vector<size_t>& which);
+    // evaluate sparse trials, with the incremental objective if there is one
+    virtual void evaluate(const std::vector<SparseTrial>&, std::vector<Evaluated>&);
+    // evaluate only the trials predicted by the surrogate to beat their targets,
+    // the other trials are replaced by their targets
+    virtual void screened_evaluate(std::vector<Solution>& trials, std::vector<Evaluated>& trial_results);
+    // gradient-based repair of infeasible trials, if enabled
+    virtual void repair(std::vector<Solution>& trials, std::vector<Evaluated>& trial_results);
+    // collect, inject and launch local search, report the best solution and run the generation
+    // callback, return false to stop
+    bool end_generation();
+    void local_search_step();
+    // publish the state of the current generation to `_metrics`
+    virtual void update_metrics() noexcept;
+    // the improved points replace the worst individuals they beat under the selector
+    void inject(const std::vector<LocalSearch::Refined>&);
+    void _configure();
+    void _evaluate(const std::vector<Solution>&, std::vector<Evaluated>&, const std::vector<size_t>&);
+    // points that aren't trials of the population (repair), owners[k] is the individual of point k
+    void _evaluate_points(const std::vector<Solution>&, const std::vector<size_t>& owners, std::vector<Evaluated>&);
 
 public:
+    // All parameters are resolved and validated from the config once, ConfigError is thrown on errors
+    DE(Objective, const Ranges&, const DEConfig&);
+    DE(Objective, // User-defined strategy, and strategy pointers would be destructed by user
+       const Ranges&,
+       const DEConfig&,
+       IMutator*   m,
+       ICrossover* c,
+       ISelector*  s);
     DE(Objective, // User-defined strategy, and strategy pointers would be destructed by user
         const Ranges&,
         IMutator*   m,
@@ -47,10 +168,15 @@ public:
         std::unordered_map<std::string, double> extra_para = std::unordered_map<std::string, double>{});
     virtual ~DE();
     virtual Solution solver();
+    // continue the last `solver` stopped by the generation callback with the next generation, as
+    // if it hadn't stopped (but for a local search job, collected at the stop); the random engine
+    // of the calling thread takes over the stopped one
+    Solution resume();
 
     virtual double f() const noexcept { return _f; }
     virtual double cr() const noexcept { return _cr; }
     virtual size_t np() const noexcept { return _np; }
+    const DEConfig& config() const noexcept { return _conf; }
     virtual size_t curr_gen() const noexcept { return _curr_gen; }
     virtual size_t dimension() const noexcept { return _dim; }
     virtual size_t find_best() const noexcept;
@@ -58,4 +184,63 @@ public:
     virtual std::pair<double, double> range(size_t i) const { return _ranges.at(i); }
     virtual const std::vector<Solution>& population() const noexcept { return _population; }
     virtual const std::vector<Evaluated>& evaluated() const noexcept { return _results; }
+    const EvalScheduler& scheduler() const noexcept { return _scheduler; }
+    // bound of the objective indices: NP, and NP + `ls_top_k` with local search, whose jobs
+    // evaluate concurrently with the population
+    size_t slots() const noexcept;
+    void set_schedule_policy(SchedulePolicy p, size_t chunk = 1) noexcept;
+    // min_archive: number of evaluated points before the surrogate is used, max_archive = 0 means unlimited
+    void enable_surrogate(size_t k = 5, double explore = 0.1, size_t min_archive = 0, size_t max_archive = 0);
+    const SurrogateScreen* surrogate() const noexcept { return _surrogate.get(); }
+    // progress is written to `log`, nullptr disables it
+    void set_log(std::ostream* log) noexcept { _log = log; }
+    std::ostream* log() const noexcept { return _log; }
+    // seed the random engine of the calling thread at the beginning of `solver`
+    void set_seed(uint64_t seed) noexcept { _seeded = true; _seed = seed; }
+    void set_generation_callback(GenerationCallback cb) { _on_generation = cb; }
+    const GenerationCallback& generation_callback() const noexcept { return _on_generation; }
+    bool seeded() const noexcept { return _seeded; }
+    uint64_t seed() const noexcept { return _seed; }
+    // warm start: the first individuals of the next `solver` population, the others are sampled;
+    // the rows are evaluated by `init` like sampled ones
+    void set_initial_population(const std::vector<Solution>&);
+    // prepare the next `solver` call with another population size and generation limit, the
+    // population buffers, thread pool or NUMA team and evaluation statistics are kept
+    virtual void reinitialize(size_t np, size_t max_iter);
+    // used instead of the objective for the sparse trials of `SparseBin` crossover
+    void set_incremental_objective(IncrementalObjective f) { _incremental_func = f; }
+    // cheap constraints first, then the figure of merit only for trials that can still win under
+    // the selector (ISelector::can_win). It also replaces the objective for the initial population,
+    // the repair and the sparse trials, where both stages are always evaluated
+    void set_staged_objective(ConstraintFunction constraints, FomFunction fom);
+    const StagedStats& staged_stats() const noexcept { return _staged_stats; }
+    // coarse and fine objectives: every trial of `solver` (DE and SaDE, not the sparse trials) is
+    // scored at low fidelity first, and only the trials promoted by the `mf_*` policy are evaluated
+    // at high fidelity before the selection. The initial population, the repair and the local
+    // search use the high fidelity. Ignored when a batch objective is set, like the staged objective
+    void set_multi_fidelity_objective(Objective low, Objective high);
+    void set_promotion_policy(const FidelityConfig&);
+    FidelityStats fidelity_stats() const noexcept;
+    // used instead of the objective for every evaluation, one call per batch at a time; the local
+    // search still evaluates its points with the objective, concurrently with the batches
+    void set_batch_objective(BatchObjective f) { _batch_func = f; }
+    // persistent evaluation store shared with other runs and processes, see EvalCache. Every
+    // evaluation but the incremental ones is looked up first, and the misses are appended
+    void enable_eval_cache(const std::string& path, const std::string& tag, double resolution = 1e-9);
+    const EvalCache* eval_cache() const noexcept { return _cache.get(); }
+    void enable_gradient_repair(double prob, size_t max_steps = 3, double fd_step = 1e-6);
+    const GradientRepair* gradient_repair() const noexcept { return _repair.get(); }
+    // NUMA mode of `solver`: a team of threads pinned node by node owns contiguous blocks of
+    // individuals, allocates their population, donor and trial rows (first touch), and runs their
+    // mutation, crossover and evaluation, so only the random donors are read across nodes.
+    // The mutator and crossover must be thread-safe, the evaluations use the NumaOwner schedule
+    void enable_numa(size_t num_threads = 0);
+    const NumaTeam* numa() const noexcept { return _numa.get(); }
+    // memetic polishing of the best individuals on extra threads, concurrently with the generations;
+    // the objective must allow calls from these threads while the population is evaluated
+    void enable_local_search(const LocalSearchConfig&);
+    const LocalSearch* local_search() const noexcept { return _local_search.get(); }
+    // live counters of the running solver, read them from any thread or register them with a
+    // `MetricsServer`
+    const Metrics& metrics() const noexcept { return _metrics; }
 };
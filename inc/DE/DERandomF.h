@@ -3,8 +3,13 @@
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <random>
 class DERandomF : public DE {
 public:
     using DE::DE;
     double f() const noexcept;
+
+private:
+    // N(F, fsigma), the base constructor resolved F and fsigma before this member is initialized
+    const std::normal_distribution<double>::param_type _f_param{_f, _conf.fsigma};
 };
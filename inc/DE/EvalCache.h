@@ -0,0 +1,64 @@
+#pragma once
+#include "strategy/DEInterface.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <iostream>
+#include <cstdint>
+
+// Persistent evaluation store shared by runs and processes: an append-only file of records keyed by
+// the hash of the quantized solution (`resolution` relative to the width of each range), the
+// objective version `tag`, the ranges and the objective index (e.g. 1 for a low fidelity).
+// The file is memory-mapped for the lookups; appends take an exclusive flock, refreshes a shared
+// one, so concurrent processes never read a half-written record. Records are checksummed, a tail
+// left by a crashed writer is ignored and overwritten by the next append. Change the tag whenever
+// the objective changes. POSIX only, the constructor throws std::runtime_error elsewhere
+class EvalCache
+{
+public:
+    EvalCache(const std::string& path, const std::string& tag, const Ranges& ranges, double resolution = 1e-9);
+    ~EvalCache();
+    EvalCache(const EvalCache&) = delete;
+    EvalCache& operator=(const EvalCache&) = delete;
+
+    // copy the cached results of xs[which] into `results`, return the indices that missed
+    std::vector<size_t> lookup(const std::vector<Solution>& xs, std::vector<Evaluated>& results,
+                               const std::vector<size_t>& which, unsigned objective = 0);
+    bool find(const Solution& x, Evaluated& result, unsigned objective = 0);
+    // append the results of xs[which] in one locked write, points already stored are skipped
+    void insert(const std::vector<Solution>& xs, const std::vector<Evaluated>& results,
+                const std::vector<size_t>& which, unsigned objective = 0);
+    void insert(const Solution& x, const Evaluated& result, unsigned objective = 0);
+
+    const std::string& path() const noexcept { return _path; }
+    size_t lookups() const noexcept { return _lookups.load(); }
+    size_t hits() const noexcept { return _hits.load(); }
+    size_t inserted() const noexcept { return _inserted.load(); }
+    double hit_rate() const noexcept;
+    size_t records() const; // in the file, from every process, as of the last refresh
+    void report(std::ostream&) const;
+
+private:
+    const std::string _path;
+    const Ranges _ranges;
+    const double _resolution;
+    uint64_t _base; // hash of the tag, ranges and resolution
+    int _fd;
+    const char* _map;
+    size_t _mapped;  // bytes mapped
+    size_t _scanned; // end of the last valid record indexed
+    std::unordered_multimap<uint64_t, size_t> _index; // key -> record offset
+    mutable std::mutex _m; // guards the mapping and the index
+    std::atomic<size_t> _lookups;
+    std::atomic<size_t> _hits;
+    std::atomic<size_t> _inserted;
+
+    uint64_t _scope(unsigned objective) const noexcept;
+    uint64_t _key(const Solution&, uint64_t scope, std::vector<int64_t>& q) const;
+    bool _get(uint64_t key, uint64_t scope, const std::vector<int64_t>& q, Evaluated&) const;
+    void _remap(size_t size);
+    void _scan(size_t size);
+    void _refresh();
+};
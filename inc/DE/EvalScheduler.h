@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <iostream>
+#include <cstdint>
+#include <exception>
+enum SchedulePolicy
+{
+    OmpStatic = 0,
+    OmpDynamic,
+    OmpGuided,
+    WorkStealing,   // persistent thread pool shared by all DE instances
+    LongestFirst,   // longest-predicted-first, dispatched on the thread pool
+    NumaOwner       // every index on its owner thread of the attached NumaTeam
+};
+const std::unordered_map<std::string, SchedulePolicy> sp_lut{{"static", OmpStatic},
+                                                             {"dynamic", OmpDynamic},
+                                                             {"guided", OmpGuided},
+                                                             {"work-stealing", WorkStealing},
+                                                             {"longest-first", LongestFirst},
+                                                             {"numa-owner", NumaOwner}};
+
+// Log2-bucketed latency histogram, bucket k counts samples in [2^k, 2^(k+1)) microseconds,
+// safe to record from multiple threads
+class LatencyHistogram
+{
+public:
+    static const size_t num_buckets = 40;
+    LatencyHistogram() { clear(); }
+    void record(double seconds) noexcept;
+    void clear() noexcept;
+    size_t count() const noexcept { return _count.load(); }
+    size_t bucket(size_t k) const noexcept { return _buckets[k].load(); }
+    double mean() const noexcept;
+    double max() const noexcept { return 1e-9 * _max_ns.load(); }
+    double quantile(double q) const noexcept; // upper bound of the bucket containing q-quantile, in seconds
+    void print(std::ostream&) const;
+
+private:
+    std::atomic<uint64_t> _buckets[num_buckets];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum_ns;
+    std::atomic<uint64_t> _max_ns;
+};
+
+// Persistent work-stealing thread pool, every worker owns a deque, pops from its front and
+// steals from the back of the others. A thread waiting for its batch only helps with
+// tasks of that batch, so nested batches (a task that submits a batch) never interleave
+class ThreadPool
+{
+public:
+    typedef std::function<void(size_t)> Task;
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& instance(); // shared by all DE instances
+    static void set_default_size(size_t num_threads); // call before the first `instance()`
+
+    size_t size() const noexcept { return _workers.size(); }
+    // run task(order[0]), task(order[1]), ..., and return after all of them finished,
+    // tasks are dealt to workers in the given order, so put expensive ones first
+    void run(const std::vector<size_t>& order, const Task& task);
+    void run(size_t n, const Task& task);
+
+private:
+    struct Batch
+    {
+        const Task* task;
+        std::atomic<size_t> remaining;
+        std::mutex m;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    struct Item
+    {
+        Batch* batch;
+        size_t idx;
+    };
+    struct Worker
+    {
+        std::mutex m;
+        std::deque<Item> queue;
+    };
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    std::mutex _sleep_m;
+    std::condition_variable _sleep_cv;
+    std::atomic<size_t> _pending;
+    bool _stop;
+
+    void _work(size_t id);
+    bool _take(size_t id, Item&);
+    bool _take_from(const Batch*, Item&);
+    void _execute(const Item&);
+    void _run(size_t n, const size_t* order, const Task&); // order == nullptr: 0 .. n - 1
+};
+
+class NumaTeam;
+// Run the evaluations of one generation under a configurable policy, and record
+// the latency of every evaluation. A scheduler runs one batch at a time, its scratch is reused
+class EvalScheduler
+{
+public:
+    explicit EvalScheduler(SchedulePolicy p = OmpStatic, size_t chunk = 1);
+    // eval(0) .. eval(n - 1) for the individuals 0 .. n - 1
+    void run(size_t n, const std::function<void(size_t)>& eval);
+    // eval(k) evaluates individual which[k], its duration is recorded under which[k], so a
+    // subset batch leaves the predictions of the other individuals untouched
+    void run(const std::vector<size_t>& which, const std::function<void(size_t)>& eval);
+    // a single call evaluates all n points, the callee does its own parallelization, so
+    // every point is recorded with the average latency
+    void run_batch(size_t n, const std::function<void()>& eval);
+
+    SchedulePolicy policy() const noexcept { return _policy; }
+    void set_policy(SchedulePolicy p) noexcept { _policy = p; }
+    size_t chunk() const noexcept { return _chunk; }
+    void set_chunk(size_t c) noexcept { _chunk = c == 0 ? 1 : c; }
+    // team used by the NumaOwner policy, not owned
+    void set_team(NumaTeam* team) noexcept { _team = team; }
+    size_t evaluations() const noexcept { return _num_eval.load(); }
+    // add evaluations made outside `run`, e.g. by local search
+    void count(size_t n) noexcept { _num_eval.fetch_add(n); }
+    const LatencyHistogram& latency() const noexcept { return _latency; }
+    // duration of the last evaluation of each individual, used as the prediction of `LongestFirst`
+    const std::vector<double>& durations() const noexcept { return _durations; }
+    double busy_time() const noexcept { return _busy; }   // accumulated evaluation time
+    double wall_time() const noexcept { return _wall; }   // accumulated batch makespan
+    double efficiency() const noexcept; // busy_time / (wall_time * threads)
+    void clear_stats() noexcept;
+    void report(std::ostream&) const;
+
+private:
+    SchedulePolicy _policy;
+    size_t _chunk;
+    NumaTeam* _team;
+    std::vector<double> _durations;
+    LatencyHistogram _latency;
+    std::atomic<size_t> _num_eval;
+    double _busy;
+    double _wall;
+    double _capacity;
+    // scratch of `run`, kept between the generations so a batch doesn't allocate
+    std::vector<size_t> _all; // 0 .. n - 1
+    std::vector<double> _batch_durations;
+    std::vector<size_t> _order;
+    std::vector<size_t> _position;
+};
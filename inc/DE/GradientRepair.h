@@ -0,0 +1,46 @@
+#pragma once
+#include "strategy/DEInterface.h"
+#include <vector>
+#include <functional>
+#include <iostream>
+class DE;
+struct RepairStats
+{
+    size_t attempted        = 0; // infeasible trials selected for repair
+    size_t improved         = 0; // trials whose total violation was reduced
+    size_t became_feasible  = 0; // trials repaired to zero violation
+    size_t evaluations      = 0; // extra evaluations spent, finite differences included
+    double violation_before = 0;
+    double violation_after  = 0;
+    double evaluations_per_feasible() const noexcept;
+};
+
+// Gradient-based mutation of the epsilon constrained DE (Takahama & Sakai, 2006):
+// with probability `prob`, an infeasible trial x is moved by the Newton-like step
+//     x <- x - pinv(J(x)) * C(x)
+// where C is the vector of violated constraints and J its Jacobian estimated by forward
+// finite differences, repeated at most `max_steps` times while the trial stays infeasible
+class GradientRepair
+{
+public:
+    // evaluate points, owners[k] is the trial that point k belongs to
+    typedef std::function<void(const std::vector<Solution>&, const std::vector<size_t>& owners,
+                               std::vector<Evaluated>&)>
+        BatchEvaluator;
+    // fd_step is relative to the width of each range
+    GradientRepair(double prob, size_t max_steps, double fd_step = 1e-6);
+    // the finite difference probes of every repair step are evaluated as one batch by `probe`,
+    // which only has to fill the violations, the repaired trials by `evaluate`
+    void repair(const DE&, const BatchEvaluator& probe, const BatchEvaluator& evaluate,
+                std::vector<Solution>& trials, std::vector<Evaluated>& trial_results);
+    const RepairStats& stats() const noexcept { return _stats; }
+    void report(std::ostream&) const;
+
+private:
+    const double _prob;
+    const size_t _max_steps;
+    const double _fd_step;
+    RepairStats _stats;
+    bool _newton_step(const DE&, const Solution& x, const Evaluated& fx, const std::vector<Evaluated>& probes,
+                      const std::vector<double>& hs, Solution& out) const;
+};
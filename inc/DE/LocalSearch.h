@@ -0,0 +1,95 @@
+#pragma once
+#include "strategy/DEInterface.h"
+#include "DEConfig.h"
+#include "EvalScheduler.h"
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <iostream>
+class DE;
+struct LocalSearchStats
+{
+    size_t launches    = 0;
+    size_t refined     = 0; // points given to local search
+    size_t improved    = 0; // refined points better than their starting point
+    size_t injected    = 0; // improved points that replaced an individual of the population
+    size_t evaluations = 0;
+};
+
+// Memetic polishing: the best individuals are refined by Nelder-Mead or a bounded quasi-Newton
+// method, one thread each, while the generation loop goes on. The `top_k` threads are started by
+// the first launch and kept for the next ones. A job is collected a fixed number of generations
+// after its launch, so a seeded run stays reproducible. Feasible points are refined inside the
+// feasible region, infeasible ones by minimizing their total violation, always within the ranges.
+// The points are evaluated with the point objective of the DE concurrently with its own
+// evaluations, never with its batch objective; job k uses the objective index NP + k, so an
+// index is never evaluated twice at the same time
+class LocalSearch
+{
+public:
+    typedef std::function<Evaluated(size_t, const Solution&)> PointObjective;
+    struct Refined
+    {
+        size_t origin = 0; // index of the starting individual at launch
+        Solution x;
+        Evaluated result;
+        Evaluated start_result;
+    };
+    explicit LocalSearch(const LocalSearchConfig&);
+    ~LocalSearch();
+    LocalSearch(const LocalSearch&) = delete;
+    LocalSearch& operator=(const LocalSearch&) = delete;
+
+    const LocalSearchConfig& config() const noexcept { return _conf; }
+    bool running() const noexcept { return _running; }
+    size_t launched_at() const noexcept { return _launched_at; }
+    // evaluations still allowed by `share`, given all evaluations spent so far
+    size_t allowance(size_t total_evaluations) const noexcept;
+    // refine population[indices[k]] on one thread each, with at most `budget` evaluations per point;
+    // points already polished to convergence are skipped. The spent evaluations are added to
+    // `counter` when the job is collected
+    void launch(const DE&, size_t gen, const std::vector<size_t>& indices, size_t budget,
+                const PointObjective&, EvalScheduler& counter);
+    // ask the running job to return its best points so far
+    void stop() noexcept { _stop.store(true); }
+    // wait for the running job, rethrow its exception if any
+    std::vector<Refined> collect();
+    // drop the running job and forget the polished points, e.g. before a restart
+    void reset();
+    void add_injected(size_t n) noexcept { _stats.injected += n; }
+    const LocalSearchStats& stats() const noexcept { return _stats; }
+    // fraction of `total_evaluations` spent by local search
+    double fraction(size_t total_evaluations) const noexcept;
+    void report(std::ostream&, size_t total_evaluations) const;
+
+private:
+    struct Job
+    {
+        Refined out;
+        size_t evaluations = 0;
+        bool converged     = false;
+        std::exception_ptr error;
+    };
+    const LocalSearchConfig _conf;
+    LocalSearchStats _stats;
+    std::vector<Job> _jobs;
+    std::vector<std::thread> _threads; // worker k runs job k of every launch
+    std::mutex _m;
+    std::condition_variable _wake, _done;
+    size_t _epoch;   // launches handed to the workers
+    size_t _pending; // jobs of the current launch not finished yet
+    bool _quit;
+    bool _running;
+    std::function<void(size_t)> _task; // runs job k, set before `_epoch` is bumped
+    std::atomic<bool> _stop;
+    size_t _launched_at;
+    EvalScheduler* _counter;
+    std::vector<Solution> _polished; // converged points, not refined again
+
+    void _work(size_t k);
+    void _join() noexcept; // wait for the running job
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <iostream>
+#include <cstdint>
+class EvalScheduler;
+enum SolverPhase
+{
+    PhaseInit = 0,
+    PhaseVariation, // mutation and crossover
+    PhaseEvaluation,
+    PhaseRepair,
+    PhaseSelection,
+    PhaseLocalSearch,
+    NumPhases
+};
+extern const char* const phase_names[NumPhases];
+
+// Live state of one solver. It is written by the solver thread only, with relaxed atomic stores, and
+// read by the metrics server without taking any lock
+class Metrics
+{
+public:
+    static const size_t max_strategies = 16;
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // evaluations are read live from the scheduler
+    void attach(const EvalScheduler* scheduler) noexcept { _scheduler = scheduler; }
+    // beginning of a run: generation 0, evaluation rate measured from now
+    void start() noexcept;
+    void set_running(bool r) noexcept; // the evaluation rate is frozen at the end of a run
+    void set_generation(size_t g) noexcept { _generation.store(g, std::memory_order_relaxed); }
+    void set_best(double fom, double violation) noexcept;
+    void set_epsilon(double level) noexcept;
+    void set_strategy_probabilities(const std::vector<double>&) noexcept;
+    void add_phase(SolverPhase p, double seconds) noexcept;
+
+    bool running() const noexcept { return _running.load(std::memory_order_relaxed); }
+    size_t generation() const noexcept { return _generation.load(std::memory_order_relaxed); }
+    size_t evaluations() const noexcept;
+    double evaluations_per_second() const noexcept; // from `start` to now or the end of the run
+    double best_fom() const noexcept { return _best_fom.load(std::memory_order_relaxed); }
+    double best_violation() const noexcept { return _best_violation.load(std::memory_order_relaxed); }
+    bool has_epsilon() const noexcept { return _has_epsilon.load(std::memory_order_relaxed); }
+    double epsilon() const noexcept { return _epsilon.load(std::memory_order_relaxed); }
+    std::vector<double> strategy_probabilities() const;
+    double phase_seconds(SolverPhase p) const noexcept;
+
+private:
+    const EvalScheduler* _scheduler;
+    std::atomic<bool> _running;
+    std::atomic<size_t> _generation;
+    std::atomic<size_t> _start_evals;
+    std::atomic<int64_t> _start_ns;
+    std::atomic<int64_t> _end_ns;
+    std::atomic<double> _best_fom;
+    std::atomic<double> _best_violation;
+    std::atomic<bool> _has_epsilon;
+    std::atomic<double> _epsilon;
+    std::atomic<size_t> _num_strategies;
+    std::atomic<double> _strategy_prob[max_strategies];
+    std::atomic<uint64_t> _phase_ns[NumPhases];
+};
+
+// adds the lifetime of the timer to a phase
+class PhaseTimer
+{
+public:
+    PhaseTimer(Metrics& m, SolverPhase p) : _m(m), _p(p), _t0(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Metrics& _m;
+    const SolverPhase _p;
+    const std::chrono::steady_clock::time_point _t0;
+};
+
+// Prometheus text exposition of registered solvers, served on a Unix socket (`unix:/path`) or a
+// localhost TCP port (`9100`, `localhost:9100`, port 0 picks a free one) by a background thread.
+// HTTP clients get `GET /metrics` (curl, Prometheus), clients silent for 100 ms get the text
+// (socat, nc). The clients are polled together, a slow one never delays another. POSIX only, the
+// constructor throws std::runtime_error elsewhere
+class MetricsServer
+{
+public:
+    explicit MetricsServer(const std::string& address);
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // the metrics must outlive the server or be removed first
+    void add(const std::string& run, const Metrics&);
+    void remove(const std::string& run);
+    // bound address, with the actual port for port 0
+    const std::string& address() const noexcept { return _address; }
+    void write(std::ostream&) const;
+
+    // fetch the text from a server, for tests and scripts
+    static std::string fetch(const std::string& address);
+
+private:
+    std::string _address;
+    std::string _unix_path;
+    int _fd;
+    std::atomic<bool> _stop;
+    mutable std::mutex _m; // guards the registry, never taken by the solvers
+    std::vector<std::pair<std::string, const Metrics*>> _runs;
+    std::thread _thread;
+
+    void _serve();
+    void _answer(int client, const std::string& request) const;
+};
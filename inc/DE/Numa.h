@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+// "0-3,8" -> {0, 1, 2, 3, 8}, throw ConfigError on malformed lists
+std::vector<int> parse_cpu_list(const std::string&);
+// bind the calling thread to one CPU, return false if it is not supported or fails
+bool pin_thread(int cpu);
+
+// CPUs of every NUMA node that the process is allowed to run on, read from
+// /sys/devices/system/node, a single node holds all allowed CPUs elsewhere
+struct NumaTopology
+{
+    std::vector<std::vector<int>> node_cpus;
+    static NumaTopology detect();
+    size_t nodes() const noexcept { return node_cpus.size(); }
+};
+
+// Persistent team of pinned threads, consecutive threads are placed on the same node and the
+// nodes get equal shares. Index i of a batch of n always runs on thread owner(i, n), so that
+// everything an index allocates first (first-touch) stays on its owner's node
+class NumaTeam
+{
+public:
+    typedef std::function<void(size_t)> Task;
+    explicit NumaTeam(size_t num_threads = 0); // 0: omp_get_max_threads()
+    ~NumaTeam();
+    NumaTeam(const NumaTeam&) = delete;
+    NumaTeam& operator=(const NumaTeam&) = delete;
+
+    size_t size() const noexcept { return _size; }
+    const NumaTopology& topology() const noexcept { return _topology; }
+    size_t node_of(size_t thread) const noexcept { return _node[thread]; }
+    int cpu_of(size_t thread) const noexcept { return _cpu[thread]; } // -1: not pinned
+    // contiguous blocks, thread t owns [ceil(t * n / size), ceil((t + 1) * n / size))
+    size_t owner(size_t i, size_t n) const noexcept { return i * size() / n; }
+    // run task(i) for every i in [0, n) on its owner, must not be called from a task
+    void run(size_t n, const Task& task);
+
+private:
+    NumaTopology _topology;
+    size_t _size;
+    std::vector<size_t> _node;
+    std::vector<int> _cpu;
+    std::vector<std::thread> _threads;
+    std::mutex _run_m; // one batch at a time
+    std::mutex _m;
+    std::condition_variable _start;
+    std::condition_variable _done;
+    const Task* _task;
+    size_t _n;
+    size_t _remaining;
+    uint64_t _generation;
+    std::exception_ptr _error;
+    bool _stop;
+
+    void _work(size_t id);
+};
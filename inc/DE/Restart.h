@@ -0,0 +1,43 @@
+#pragma once
+#include "DEOrigin.h"
+#include <vector>
+#include <iostream>
+
+struct RestartRun
+{
+    size_t np          = 0;
+    size_t generations = 0;
+    size_t evaluations = 0;
+    Evaluated best_result;
+    bool stagnated     = false;
+};
+
+// IPOP restarts: `solver` of the wrapped DE (or SaDE) is run until its best stops improving or its
+// population has converged, then it is restarted from a new random population with NP multiplied
+// by `growth`, until the restarts or the shared evaluation budget are used up. The same DE object
+// is reinitialized, so its buffers, threads and statistics are reused. The global best is ordered
+// by (total violation, FOM). The generation callback of the DE is still called, and stops
+// everything when it returns false
+class RestartController
+{
+public:
+    RestartController(DE& de, const RestartConfig&);
+    explicit RestartController(DE& de); // with de.config().restart
+    Solution solver();
+
+    const Solution& best() const noexcept { return _best; }
+    const Evaluated& best_result() const noexcept { return _best_result; }
+    const std::vector<RestartRun>& runs() const noexcept { return _runs; }
+    size_t evaluations() const noexcept { return _evaluations; }
+    void report(std::ostream&) const;
+
+private:
+    DE& _de;
+    const RestartConfig _conf;
+    Solution _best;
+    Evaluated _best_result;
+    std::vector<RestartRun> _runs;
+    size_t _evaluations;
+
+    bool _budget_left(size_t spent) const noexcept { return _conf.budget == 0 || spent < _conf.budget; }
+};
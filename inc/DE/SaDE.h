@@ -26,20 +26,34 @@ protected:
     std::deque<std::vector<size_t>> _mem_failure;
     std::vector<std::deque<std::vector<double>>> _crmemory;
     double _curr_cr;
+    // per-generation scratch, sized by `init`
+    std::vector<size_t> _s_vec;        // strategy of every trial
+    std::vector<double> _cr_vec;       // CR of every trial
+    std::vector<double> _crmu_vec;     // median successful CR of every strategy
+    std::vector<double> _cr_pool;      // successful CRs of one strategy in the last LP generations
+    std::vector<size_t> _success_r;    // successes and failures of every strategy this generation
+    std::vector<size_t> _failure_r;
+    std::vector<size_t> _num_success;  // ... and over the last LP generations
+    std::vector<size_t> _num_failure;
+    std::vector<double> _success_rate;
     std::vector<Strategy>           _init_strategy() const noexcept;
     std::vector<double>             _init_strategy_prob() const noexcept;
     size_t _select_strategy(const std::vector<double>& probs) const noexcept;
-    std::vector<double> gen_cr_vec(const std::vector<size_t>&) const noexcept;
+    void gen_cr_vec(const std::vector<size_t>& s_vec, std::vector<double>& cr_vec) noexcept;
     void _update_memory_prob(const std::vector<size_t>& strategy_vec,
                              const std::vector<Evaluated>& old_result,
                              const std::vector<Evaluated>& new_result) noexcept;
     void _update_cr_memory(const std::vector<size_t>&, const std::vector<double>&,
                            const std::vector<Evaluated>&, const std::vector<Evaluated>&) noexcept;
+    void init();                    // also sizes the scratch
+    void update_metrics() noexcept; // also the strategy probabilities
+    Solution evolve();
 
 public:
     SaDE(const SaDE&) = delete;
     SaDE(SaDE&&)      = delete;
     SaDE& operator=(const SaDE&) = delete;
+    SaDE(Objective, const Ranges&, const DEConfig&); // the `sade` parameters are required
     SaDE(Objective, 
          const Ranges&,
          size_t np,
@@ -47,7 +61,7 @@ public:
          SelectionStrategy, 
          std::unordered_map<std::string, double> extra);
     ~SaDE() = default;
+    void reinitialize(size_t np, size_t max_iter); // also forgets the learned strategies and CR
     double f()  const noexcept;
     double cr() const noexcept;
-    Solution solver();
 };
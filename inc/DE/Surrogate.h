@@ -0,0 +1,97 @@
+#pragma once
+#include "strategy/DEInterface.h"
+#include <vector>
+#include <deque>
+#include <utility>
+#include <iostream>
+class DE;
+// k-d tree over points of a fixed dimension, for k-nearest-neighbour queries
+class KDTree
+{
+public:
+    void build(const std::vector<Solution>& points);
+    // indices and squared distances of the k nearest points, nearest first
+    void knn(const Solution& query, size_t k, std::vector<std::pair<double, size_t>>& out) const;
+    size_t size() const noexcept { return _points == nullptr ? 0 : _points->size(); }
+
+private:
+    struct Node
+    {
+        size_t point;
+        size_t axis;
+        size_t left;
+        size_t right;
+    };
+    static const size_t nil = static_cast<size_t>(-1);
+    const std::vector<Solution>* _points = nullptr;
+    std::vector<Node> _nodes;
+    size_t _root = nil;
+    size_t _build(std::vector<size_t>& idx, size_t lo, size_t hi, size_t depth);
+    void _search(size_t node, const Solution& q, size_t k, std::vector<std::pair<double, size_t>>& heap) const;
+};
+
+class ISurrogate
+{
+public:
+    virtual void fit(const std::vector<Solution>& xs, const std::vector<Evaluated>& ys) = 0;
+    virtual Evaluated predict(const Solution&) const = 0;
+    virtual ~ISurrogate() {}
+};
+// inverse-distance weighted k-nearest-neighbour regression of FOM and total violation
+class Surrogate_KNN : public ISurrogate
+{
+    const size_t _k;
+    KDTree _tree;
+    const std::vector<Evaluated>* _ys = nullptr;
+
+public:
+    explicit Surrogate_KNN(size_t k) : _k(k) {}
+    void fit(const std::vector<Solution>& xs, const std::vector<Evaluated>& ys);
+    Evaluated predict(const Solution&) const;
+};
+
+struct SurrogateStats
+{
+    size_t screened        = 0; // trials compared against their targets by the surrogate
+    size_t predicted_win   = 0; // trials predicted to beat their target, all evaluated
+    size_t true_win        = 0; // ... of which really beat the target
+    size_t explored        = 0; // trials predicted to lose, evaluated anyway
+    size_t explored_win    = 0; // ... of which beat the target
+    size_t skipped         = 0; // evaluations saved
+    double accuracy() const noexcept;  // fraction of correct predictions among the evaluated trials
+    double precision() const noexcept; // fraction of predicted winners really winning
+};
+
+// Pre-screen trial vectors with a surrogate fitted on the archive of evaluated points,
+// only trials predicted to win (and a random `explore` fraction of the others) need a true evaluation
+class SurrogateScreen
+{
+public:
+    SurrogateScreen(ISurrogate* model, double explore, size_t min_archive, size_t max_archive);
+    ~SurrogateScreen();
+    SurrogateScreen(const SurrogateScreen&) = delete;
+    SurrogateScreen& operator=(const SurrogateScreen&) = delete;
+
+    void add(const DE&, const Solution&, const Evaluated&);
+    bool ready() const noexcept { return _xs.size() >= _min_archive; }
+    // indices of trials that should be truly evaluated
+    std::vector<size_t> screen(const DE&, ISelector&, const std::vector<Solution>& trials,
+                               const std::vector<Evaluated>& target_results);
+    // compare the predictions of `screen` with the true results of the evaluated trials
+    void record(ISelector&, const std::vector<size_t>& evaluated, const std::vector<Evaluated>& trial_results,
+                const std::vector<Evaluated>& target_results);
+    const SurrogateStats& stats() const noexcept { return _stats; }
+    void report(std::ostream&) const;
+
+private:
+    ISurrogate* _model;
+    const double _explore;
+    const size_t _min_archive;
+    const size_t _max_archive;
+    std::vector<Solution>  _xs; // normalized to [0, 1]
+    std::vector<Evaluated> _ys;
+    size_t _oldest; // ring buffer position once the archive is full
+    std::vector<char> _predicted_win;
+    SurrogateStats _stats;
+    Solution _normalize(const DE&, const Solution&) const;
+};
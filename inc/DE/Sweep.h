@@ -0,0 +1,87 @@
+#pragma once
+#include "DEOrigin.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <memory>
+#include <functional>
+#include <iostream>
+#include <cstdint>
+struct SweepConfig
+{
+    std::string name;
+    DEVariant variant    = Origin;
+    MutationStrategy ms  = Best1;  // ignored by SaDE
+    CrossoverStrategy cs = Bin;    // ignored by SaDE
+    SelectionStrategy ss = StaticPenalty;
+    double f             = 0.8;
+    double cr            = 0.8;
+    size_t np            = 100;
+    size_t max_iter      = 200;
+    uint64_t seed        = 0; // the run seed is derived from it and the position of the config in the sweep
+    std::unordered_map<std::string, double> extra;
+};
+struct SweepResult
+{
+    SweepConfig config;
+    Solution best;
+    Evaluated best_result;
+    std::vector<double> curve;            // best FOM after every generation
+    std::vector<double> violation_curve;  // total violation of the best after every generation
+    size_t generations = 0;
+    size_t evaluations = 0;
+    double seconds     = 0;
+    bool stopped_early = false;
+};
+
+// Run many independent DE configurations concurrently on the shared thread pool, evaluations
+// of all runs are interleaved on the pool workers. With early stopping, every run first goes
+// to the checkpoint generation `min_gen`, the runs whose best is worse than the `quantile` of
+// all the bests at the checkpoint are stopped there, and the others are resumed to the end
+// (DE::resume), so the outcome doesn't depend on which runs finished first. Runs are compared
+// with the ranking selector, the selection strategy shared by the configs, or the feasibility rule
+class Sweep
+{
+public:
+    Sweep(Objective, const Ranges&);
+    void add(const SweepConfig& c) { _configs.push_back(c); }
+    // cartesian product of mutation, crossover, F, CR and seeds on top of `base`
+    static std::vector<SweepConfig> grid(const SweepConfig& base, const std::vector<MutationStrategy>&,
+                                         const std::vector<CrossoverStrategy>&, const std::vector<double>& fs,
+                                         const std::vector<double>& crs, const std::vector<uint64_t>& seeds);
+    // min_gen = 0 disables early stopping, which also needs `min_peers` runs at the checkpoint
+    void set_early_stop(size_t min_gen, double quantile = 0.75, size_t min_peers = 4);
+    // selector ranking the runs, the epsilon level being 0 at the end, Epsilon ranks like FeasibilityRule
+    void set_ranking(SelectionStrategy ss);
+    const std::vector<SweepResult>& run();
+    const std::vector<SweepResult>& results() const noexcept { return _results; }
+    void summary(std::ostream&) const;
+    // convergence curves as CSV, one column per run
+    void curves(std::ostream&) const;
+
+private:
+    Objective _func;
+    const Ranges _ranges;
+    std::vector<SweepConfig> _configs;
+    std::vector<SweepResult> _results;
+    size_t _stop_min_gen;
+    double _stop_quantile;
+    size_t _stop_min_peers;
+    bool _ranking_set;
+    SelectionStrategy _ranking;
+    std::unique_ptr<ISelector> _selector;
+    std::vector<char> _at_checkpoint;
+    std::vector<Evaluated> _checkpoint_bests; // best of every run at generation `_stop_min_gen`
+    std::vector<std::unique_ptr<DE>> _runs;   // kept from the checkpoint to the resume
+
+    // run config idx to the end, or up to generation stop_gen if it isn't 0
+    void _run_one(size_t idx, size_t stop_gen);
+    // continue a run stopped at the checkpoint to the end
+    void _resume_one(size_t idx);
+    // time `solve` and collect the outcome of run idx
+    void _finish(size_t idx, const std::function<Solution()>& solve);
+    // strict order of the selector
+    bool _ahead(const Evaluated& a, const Evaluated& b) const;
+    std::vector<char> _hopeless() const;
+};
@@ -2,61 +2,156 @@
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include "DEInterface.h"
-class Mutator_Rand_1 : public IMutator
+#include "../DEConfig.h"
+// The built-in mutators and crossovers write into the caller's rows, their value-returning
+// methods allocate a row and forward to `mutate_into` / `crossover_into`
+class BuiltInMutator : public IMutator
 {
 public:
     Solution mutation_solution(const DE&, size_t);
+    void mutate_into(const DE&, size_t, Solution&);
+    void mutate_at(const DE&, size_t, const std::vector<size_t>&, Solution&);
+    void mutate_all(const DE&, std::vector<Solution>&);
+    bool per_target() const noexcept { return true; }
+
+protected:
+    // the donor at the coordinates index[0 .. n - 1] into out[0 .. n - 1], at all the coordinates
+    // when index is null
+    virtual void _mutate(const DE&, size_t idx, const size_t* index, size_t n, Scalar* out) = 0;
 };
-class Mutator_Rand_2 : public IMutator
+class BuiltInCrossover : public ICrossover
 {
 public:
-    Solution mutation_solution(const DE&, size_t);
+    Solution crossover_solution(const DE&, const Solution&, const Solution&);
+    void crossover_into(const DE&, const Solution&, const Solution&, Solution&) = 0;
+    void crossover_all(const DE&, const std::vector<Solution>&, const std::vector<Solution>&,
+                       std::vector<Solution>&);
+    bool per_target() const noexcept { return true; }
 };
-class Mutator_Best_1 : public IMutator
+class Mutator_Rand_1 : public BuiltInMutator
 {
-public:
-    Solution mutation_solution(const DE&, size_t);
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
 };
-class Mutator_Best_2 : public IMutator
+class Mutator_Rand_2 : public BuiltInMutator
 {
-public:
-    Solution mutation_solution(const DE&, size_t);
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
 };
-class Mutator_RandToBest_1 : public IMutator
+class Mutator_Best_1 : public BuiltInMutator
 {
-public:
-    Solution mutation_solution(const DE&, size_t);
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
+};
+class Mutator_Best_2 : public BuiltInMutator
+{
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
 };
-class Mutator_RandToBest_2 : public IMutator
+class Mutator_RandToBest_1 : public BuiltInMutator
+{
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
+};
+class Mutator_RandToBest_2 : public BuiltInMutator
+{
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
+};
+class Mutator_CurrentToRand_1 : public BuiltInMutator
+{
+protected:
+    void _mutate(const DE&, size_t, const size_t*, size_t, Scalar*);
+};
+class Crossover_Bin : public BuiltInCrossover
 {
 public:
-    Solution mutation_solution(const DE&, size_t);
+    void crossover_into(const DE&, const Solution&, const Solution&, Solution&);
 };
-class Mutator_CurrentToRand_1 : public IMutator
+class Crossover_Exp : public BuiltInCrossover
 {
 public:
-    Solution mutation_solution(const DE&, size_t);
+    void crossover_into(const DE&, const Solution&, const Solution&, Solution&);
 };
-class Crossover_Bin : public ICrossover
+// Binomial crossover whose crossover positions are drawn by geometric skip sampling,
+// so that a trial costs O(CR * dim) random numbers and is stored as a sparse delta
+class Crossover_SparseBin : public ICrossover
 {
 public:
     Solution crossover_solution(const DE&, const Solution&, const Solution&);
+    bool sparse() const noexcept { return true; }
+    void crossover_sparse(const DE&, size_t, const Solution&, const Solution&, SparseTrial&);
+    bool samples_positions() const noexcept { return true; }
+    void sample_positions(const DE&, size_t, SparseTrial&);
+    bool per_target() const noexcept { return true; }
 };
-class Crossover_Exp : public ICrossover
+// Binomial crossover in the eigenbasis of the population covariance, rotation invariant: a trial
+// is target + sum of the selected eigen-components of (donor - target). The covariance follows the
+// population incrementally, the rows replaced by the selection (`population_changed`) being swapped
+// out of it (rank-one downdate and update, O(dim^2) each); it is recomputed from the population when
+// the replaced rows aren't known. Every `eig_period` generations a Jacobi decomposition of a snapshot
+// is started on a worker thread and collected `eig_period` generations later, so the basis in use
+// doesn't depend on timing. Until the first one is collected, and for a fraction 1 - `eig_prob` of
+// the trials, the crossover is coordinate-wise. Coordinates leaving their range are moved halfway
+// between the target and the bound. The covariance, its snapshot and the basis take O(dim^2) memory
+// and a Jacobi sweep O(dim^3) time, so above `max_dim` dimensions the crossover is plain binomial
+class Crossover_Eigen : public BuiltInCrossover
 {
 public:
-    Solution crossover_solution(const DE&, const Solution&, const Solution&);
+    Crossover_Eigen(size_t period, double prob, size_t max_dim = 500);
+    ~Crossover_Eigen();
+    Crossover_Eigen(const Crossover_Eigen&) = delete;
+    Crossover_Eigen& operator=(const Crossover_Eigen&) = delete;
+    void crossover_into(const DE&, const Solution&, const Solution&, Solution&);
+    void population_changed(const DE&, const std::vector<size_t>* replaced, const std::vector<Solution>& previous);
+    bool eigenbasis_ready() const noexcept { return !_identity; }
+    size_t refreshes() const noexcept { return _refreshes; } // decompositions collected
+    // running mean and scatter ([dim][dim]) of the population, between two generations
+    const std::vector<double>& mean() const noexcept { return _mean; }
+    const std::vector<double>& scatter() const noexcept { return _scatter; }
+
+private:
+    const size_t _period;
+    const double _prob;
+    const size_t _max_dim;
+    Crossover_Bin _bin; // above `_max_dim`
+    std::mutex _m; // the first call of a generation syncs, the others wait for it
+    std::atomic<size_t> _synced_gen;
+    size_t _n;                    // rows in the covariance
+    bool _stale;                  // rows changed without being reported, recompute at the next sync
+    std::vector<double> _mean;    // [dim]
+    std::vector<double> _scatter; // [dim][dim], sum of the centered outer products
+    std::vector<double> _basis;   // [k][dim], eigenvector k contiguous
+    bool _identity;
+    std::thread _worker;
+    std::vector<double> _job_cov, _job_basis; // owned by the worker while it runs
+    size_t _launched_gen;
+    size_t _refreshes;
+
+    void _sync(const DE&);
+    void _reset(const std::vector<Solution>&);
+    void _recompute(const std::vector<Solution>&); // mean and scatter from the population
+    void _replace(const Solution& old_row, const Solution& new_row);
+    void _join() noexcept;
 };
 class Selector_StaticPenalty : public ISelector
 {
 public:
     bool better(const Evaluated&, const Evaluated&);
+    void select_inplace(const DE&, std::vector<Solution>&, std::vector<Evaluated>&,
+                        std::vector<Solution>&, std::vector<Evaluated>&);
 };
 class Selector_FeasibilityRule : public ISelector
 {
 public:  // perhaps it would be better if this class inherits Selector_Epsilon and set epsilon_0 = 0
     bool better(const Evaluated&, const Evaluated&);
+    bool can_win(const DE&, const ConstraintViolation&, const Evaluated&);
+    void select_inplace(const DE&, std::vector<Solution>&, std::vector<Evaluated>&,
+                        std::vector<Solution>&, std::vector<Evaluated>&);
 };
 class Selector_Epsilon : public ISelector
 {
@@ -65,20 +160,27 @@ class Selector_Epsilon : public ISelector
     const size_t tc;
     double epsilon_0;
     double epsilon_level;
+    bool epsilon_ready; // epsilon_0 is computed for the current first generation
+    void init_epsilon(const DE&, const std::vector<Evaluated>&);
+    void update_epsilon(const DE&);
 
 public:
     bool better(const Evaluated&, const Evaluated&);
+    bool can_win(const DE&, const ConstraintViolation&, const Evaluated&);
     std::pair<std::vector<Evaluated>, std::vector<Solution> > select(const DE&,
                                                                      const std::vector<Solution>&,
                                                                      const std::vector<Solution>&,
                                                                      const std::vector<Evaluated>&,
                                                                      const std::vector<Evaluated>&);
-    Selector_Epsilon(double theta, double cp, size_t tc) : theta(theta), cp(cp), tc(tc)
+    void select_sparse(const DE&, std::vector<Solution>&, std::vector<Evaluated>&,
+                       const std::vector<SparseTrial>&, const std::vector<Evaluated>&);
+    void select_inplace(const DE&, std::vector<Solution>&, std::vector<Evaluated>&,
+                        std::vector<Solution>&, std::vector<Evaluated>&);
+    double level() const noexcept { return epsilon_level; }
+    Selector_Epsilon(double theta, double cp, size_t tc)
+        : theta(theta), cp(cp), tc(tc), epsilon_0(0), epsilon_level(0), epsilon_ready(false)
     {
         if (theta < 0 || theta > 1)
-        {
-            std::cerr << "theta should be in [0, 1]" << std::endl;
-            exit(EXIT_FAILURE);
-        }
+            throw ConfigError("theta should be in [0, 1]");
     }
 };
@@ -23,10 +23,14 @@ const std::unordered_map<std::string, MutationStrategy> ms_lut{{"rand1", Rand1},
 enum CrossoverStrategy
 {
     Bin = 0,
-    Exp
+    Exp,
+    SparseBin,
+    Eigen
 };
 const std::unordered_map<std::string, CrossoverStrategy> cs_lut{{"bin", Bin},
-                                                                {"exp", Exp}};
+                                                                {"exp", Exp},
+                                                                {"sparse-bin", SparseBin},
+                                                                {"eigen", Eigen}};
 enum SelectionStrategy
 {
     StaticPenalty = 0,
@@ -35,19 +39,59 @@ enum SelectionStrategy
 };
 const std::unordered_map<std::string, SelectionStrategy> ss_lut{
     {"static-penalty", StaticPenalty}, {"feasibility-rule", FeasibilityRule}, {"epsilon", Epsilon}};
-typedef std::vector<double> Solution;
+// Storage and arithmetic type of the population, build with DE_SINGLE_PRECISION to halve the
+// memory traffic of high dimensional problems; objective values and violations stay in double
+#ifdef DE_SINGLE_PRECISION
+typedef float Scalar;
+#else
+typedef double Scalar;
+#endif
+typedef std::vector<Scalar> Solution;
 typedef std::vector<std::pair<double, double>> Ranges;
 typedef std::vector<double> ConstraintViolation;
 typedef std::pair<double, ConstraintViolation> Evaluated;
 // all elements in constraint violation vector should be non-negative
 typedef std::function<Evaluated(const size_t, const Solution&)> Objective;
+// Staged objective: the cheap constraint violations first, then the expensive figure of merit,
+// which is skipped for trials that can't beat their targets anyway
+typedef std::function<ConstraintViolation(const size_t, const Solution&)> ConstraintFunction;
+typedef std::function<double(const size_t, const Solution&)> FomFunction;
+// Objective that evaluates a whole batch in one call, results has the same size as the batch
+typedef std::function<void(const std::vector<Solution>&, std::vector<Evaluated>& results)> BatchObjective;
+// A trial vector stored as its target plus the coordinates that differ from it
+struct SparseTrial
+{
+    size_t target = 0;
+    std::vector<size_t> index; // changed coordinates, ascending
+    Solution value;            // new values of the changed coordinates
+    void apply(Solution& x) const
+    {
+        for (size_t k = 0; k < index.size(); ++k)
+            x[index[k]] = value[k];
+    }
+};
+// Objective that evaluates a trial from its target, the target's result and the changed coordinates
+typedef std::function<Evaluated(const size_t, const Solution& target, const Evaluated& target_result,
+                                const SparseTrial&)> IncrementalObjective;
 
 class DE;
 class IMutator
 {
 public:
     virtual Solution mutation_solution(const DE&, size_t) = 0;
+    // write the donor of the idx-th target into `out`, a row of the generation arena of
+    // `DE::solver` that already has the right size; the default copies `mutation_solution`
+    virtual void mutate_into(const DE& de, size_t idx, Solution& out) { out = mutation_solution(de, idx); }
+    // only the donor coordinates `index` of the idx-th target, into `value` in the same order, for
+    // the sparse trials; the default gathers them from the whole donor of `mutate_into`
+    virtual void mutate_at(const DE& de, size_t idx, const std::vector<size_t>& index, Solution& value);
     virtual std::vector<Solution> mutation(const DE&);
+    // all the donors into the arena rows `out`, one per target; the default copies `mutation`,
+    // so that mutators overriding the batch method are still honored by the solvers
+    virtual void mutate_all(const DE& de, std::vector<Solution>& out);
+    // true if the solvers may call `mutate_into` target by target instead of `mutate_all`, e.g.
+    // on the owner threads of the NUMA mode, as the built-in mutators do
+    virtual bool per_target() const noexcept { return false; }
     virtual double boundary_constraint(std::pair<double, double>, double) const noexcept;
     virtual ~IMutator() {}
 };
@@ -56,17 +100,65 @@ class ICrossover
 public:
     virtual Solution crossover_solution(const DE&, const Solution&,
                                         const Solution&) = 0;
+    // write the trial into `trial`, an arena row distinct from the target and the donor;
+    // the default copies `crossover_solution`
+    virtual void crossover_into(const DE& de, const Solution& target, const Solution& doner, Solution& trial)
+    {
+        trial = crossover_solution(de, target, doner);
+    }
     virtual std::vector<Solution> crossover(const DE&,
                                             const std::vector<Solution>&,
                                             const std::vector<Solution>&);
+    // all the trials into the arena rows `trials`; the default copies `crossover`, so that
+    // crossovers overriding the batch method are still honored by the solvers
+    virtual void crossover_all(const DE& de, const std::vector<Solution>& targets,
+                               const std::vector<Solution>& doners, std::vector<Solution>& trials);
+    // true if the solvers may call `crossover_into` target by target instead of `crossover_all`,
+    // as the built-in crossovers do
+    virtual bool per_target() const noexcept { return false; }
+    // crossovers returning true are run through `crossover_sparse` by `DE::solver`
+    virtual bool sparse() const noexcept { return false; }
+    // default: dense crossover, then keep the coordinates that differ from the target
+    virtual void crossover_sparse(const DE&, size_t target_idx, const Solution& target,
+                                  const Solution& doner, SparseTrial&);
+    // sparse crossovers whose positions don't depend on the donor return true, `DE::solver` then
+    // draws the positions with `sample_positions` and mutates the donor only at those coordinates
+    virtual bool samples_positions() const noexcept { return false; }
+    // the target and the changed coordinates of the trial, its values are left to the caller
+    virtual void sample_positions(const DE&, size_t, SparseTrial&) {}
+    // population_changed(de, replaced, previous), called by the solvers between generations: the rows
+    // `replaced` of the population changed since the previous call, previous[i] holding the old row
+    // i, or any row may have changed when `replaced` is null (new population, local search, sparse
+    // trials, selectors not tracking their winners). The default ignores it
+    virtual void population_changed(const DE&, const std::vector<size_t>*, const std::vector<Solution>&) {}
     virtual ~ICrossover() {}
 };
 class ISelector
 {
 public:
     virtual bool better(const Evaluated&, const Evaluated&) = 0;
+    // false only if a trial with these violations loses against the target whatever its
+    // figure of merit is, the default never rejects
+    virtual bool can_win(const DE&, const ConstraintViolation&, const Evaluated&) { return true; }
     virtual std::pair<std::vector<Evaluated>, std::vector<Solution>> select(
         const DE&, const std::vector<Solution>&, const std::vector<Solution>&,
         const std::vector<Evaluated>&, const std::vector<Evaluated>&);
+    // select in place, winners are applied by patching only their changed coordinates
+    virtual void select_sparse(const DE&, std::vector<Solution>& targets, std::vector<Evaluated>& target_results,
+                               const std::vector<SparseTrial>& trials, const std::vector<Evaluated>& trial_results);
+    // select in place, the trials are left holding the losers; the default goes through `select`,
+    // so that selectors overriding only `select` keep working
+    virtual void select_inplace(const DE&, std::vector<Solution>& targets, std::vector<Evaluated>& target_results,
+                                std::vector<Solution>& trials, std::vector<Evaluated>& trial_results);
+    // targets replaced by the last `select_inplace`, whose old rows are left in the trials; null
+    // unless it went through `swap_winners`, as the built-in selectors do
+    const std::vector<size_t>* replaced() const noexcept { return _replaced_known ? &_replaced : nullptr; }
     virtual ~ISelector() {}
+
+protected:
+    std::vector<size_t> _replaced;
+    bool _replaced_known = false;
+    // winners are swapped with their targets, so no row is copied or reallocated
+    void swap_winners(const DE&, std::vector<Solution>& targets, std::vector<Evaluated>& target_results,
+                      std::vector<Solution>& trials, std::vector<Evaluated>& trial_results);
 };
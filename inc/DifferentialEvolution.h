@@ -2,3 +2,7 @@
 #include "DE/DEOrigin.h"
 #include "DE/DERandomF.h"
 #include "DE/SaDE.h"
+#include "DE/Sweep.h"
+#include "DE/Restart.h"
+#include "DE/Coevolution.h"
+#include "DE/BatchDE.h"
@@ -0,0 +1,43 @@
+/*
+ * C ABI of the objective shared libraries loaded by `de-run`.
+ *
+ * Required: de_abi_version, de_dimension, de_num_constraints, de_bounds, and at least one of
+ * de_evaluate / de_evaluate_batch (de_evaluate_batch is used if both are exported). Local search
+ * evaluates single points concurrently with the batches, it requires de_evaluate.
+ * Optional: de_setup, de_teardown.
+ *
+ * Violations are de_num_constraints() non-negative values, 0 means the constraint is satisfied.
+ * A non-zero return value of the evaluation functions marks the point(s) as invalid, they are
+ * treated as infinitely violating.
+ */
+#pragma once
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DE_OBJECTIVE_ABI_VERSION 1
+
+/* must return DE_OBJECTIVE_ABI_VERSION */
+int de_abi_version(void);
+size_t de_dimension(void);
+size_t de_num_constraints(void);
+/* fill de_dimension() lower and upper bounds */
+void de_bounds(double* lower, double* upper);
+
+/* single point, called concurrently from several threads, `index` is the individual index, or
+ * NP + k for local search job k; an index is never evaluated twice at the same time */
+int de_evaluate(size_t index, const double* x, double* fom, double* violation);
+/* n points, row-major `xs` (n * dimension) and `violations` (n * num_constraints), called by
+ * one thread at a time, parallelization is up to the library */
+int de_evaluate_batch(size_t n, const double* xs, double* foms, double* violations);
+
+/* called once before the run with the `objective_arg` config value (maybe empty),
+ * non-zero aborts the run */
+int de_setup(const char* arg);
+/* called once after the run */
+void de_teardown(void);
+
+#ifdef __cplusplus
+}
+#endif
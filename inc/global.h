@@ -1,4 +1,4 @@
 #pragma once
 #include <random>
-// Random number engine
-extern std::mt19937_64 engine;
+// Random number engine, one per thread so that concurrent DE instances don't share it
+extern thread_local std::mt19937_64 engine;
@@ -6,15 +6,15 @@
 #include <string>
 #include <algorithm>
 #include <cassert>
+#include <initializer_list>
 template <typename Integral>
 Integral random_exclusive(std::uniform_int_distribution<Integral>& distr,
-                          const std::vector<Integral>& exclude = std::vector<Integral>{})
+                          std::initializer_list<Integral> exclude = {})
 {
-    // assert(exclude.size() < (distr.b() - distr.a() + 1));
-    Integral lb = distr.a();
-    Integral ub = distr.b();
+    // the excluded values live in the caller's initializer list, nothing is allocated
+#ifndef NDEBUG
     bool all_excluded = true;
-    for (size_t i = lb; i <= ub; ++i)
+    for (Integral i = distr.a(); i <= distr.b(); ++i)
     {
         if (std::find(exclude.begin(), exclude.end(), i) == exclude.end())
         {
@@ -23,7 +23,7 @@ Integral random_exclusive(std::uniform_int_distribution<Integral>& distr,
         }
     }
     assert(all_excluded == false);
-
+#endif
     Integral rand_val;
     bool replicate = false;
     do
@@ -0,0 +1,287 @@
+#include "DE/BatchDE.h"
+#include "global.h"
+#include <algorithm>
+#include <exception>
+#include <omp.h>
+using namespace std;
+const size_t BatchDE::lanes;
+BatchDE::BatchDE(LaneObjective func, size_t num_problems, const Ranges& rg, const DEConfig& conf)
+    : BatchDE(func, vector<Ranges>(num_problems, rg), conf)
+{
+}
+BatchDE::BatchDE(LaneObjective func, const vector<Ranges>& ranges, const DEConfig& conf)
+    : _func(func),
+      _conf(conf),
+      _n(ranges.size()),
+      _dim(ranges.empty() ? 0 : ranges[0].size()),
+      _curr_gen(0),
+      _evaluations(0)
+{
+    _conf.validate();
+    if (_n == 0 || _dim == 0)
+        throw ConfigError("Empty problem batch");
+    if (_conf.ms != Rand1 && _conf.ms != Best1)
+        throw ConfigError("BatchDE supports the rand1 and best1 mutations");
+    if (_conf.cs != Bin && _conf.cs != Exp)
+        throw ConfigError("BatchDE supports the bin and exp crossovers");
+    if (_conf.ss != StaticPenalty && _conf.ss != FeasibilityRule)
+        throw ConfigError("BatchDE supports the static penalty and feasibility rule selections");
+    _blocks.resize((_n + lanes - 1) / lanes);
+    for (size_t b = 0; b < _blocks.size(); ++b)
+    {
+        Block& bk = _blocks[b];
+        bk.begin  = b * lanes;
+        bk.count  = min(lanes, _n - bk.begin);
+        bk.lb.assign(_dim * lanes, 0); // padding lanes stay at [0, 0]
+        bk.ub.assign(_dim * lanes, 0);
+        for (size_t l = 0; l < bk.count; ++l)
+        {
+            const Ranges& rg = ranges[bk.begin + l];
+            if (rg.size() != _dim)
+                throw ConfigError("All the problems of a batch should have the same dimension");
+            for (size_t j = 0; j < _dim; ++j)
+            {
+                if (!(rg[j].first <= rg[j].second))
+                    throw ConfigError("Invalid range [" + to_string(rg[j].first) + ", " + to_string(rg[j].second) +
+                                      "]");
+                bk.lb[j * lanes + l] = static_cast<Scalar>(rg[j].first);
+                bk.ub[j * lanes + l] = static_cast<Scalar>(rg[j].second);
+            }
+        }
+    }
+}
+bool BatchDE::_better(double f1, double v1, double f2, double v2) const noexcept
+{
+    return _conf.ss == StaticPenalty ? f1 + v1 <= f2 + v2 : v1 < v2 || (v1 == v2 && f1 <= f2);
+}
+void BatchDE::_evaluate(Block& bk, const vector<Scalar>& xs, vector<double>& fom, vector<double>& violation)
+{
+    for (size_t i = 0; i < _conf.np; ++i)
+        _func(bk.begin, bk.count, &xs[i * _dim * lanes], lanes, &fom[i * lanes], &violation[i * lanes]);
+}
+void BatchDE::_update_best(Block& bk)
+{
+    for (size_t l = 0; l < lanes; ++l)
+    {
+        size_t best = 0;
+        for (size_t i = 1; i < _conf.np; ++i)
+            if (!_better(bk.fom[best * lanes + l], bk.violation[best * lanes + l], bk.fom[i * lanes + l],
+                         bk.violation[i * lanes + l]))
+                best = i;
+        bk.best[l] = best;
+    }
+}
+void BatchDE::_init(Block& bk)
+{
+    const size_t rows = _conf.np * _dim * lanes;
+    bk.x.assign(rows, 0);
+    bk.trial.assign(rows, 0);
+    bk.base.assign(_dim * lanes, 0);
+    bk.fom.assign(_conf.np * lanes, 0);
+    bk.violation.assign(_conf.np * lanes, 0);
+    bk.trial_fom.assign(_conf.np * lanes, 0);
+    bk.trial_violation.assign(_conf.np * lanes, 0);
+    bk.best.assign(lanes, 0);
+    bk.d1.assign(lanes, 0);
+    bk.d2.assign(lanes, 0);
+    bk.redrawn.clear();
+    bk.redrawn.reserve(lanes);
+    bk.mask.assign(_dim, 0);
+    bk.won.assign(lanes, 0);
+    for (size_t i = 0; i < _conf.np; ++i)
+        for (size_t j = 0; j < _dim; ++j)
+            for (size_t l = 0; l < bk.count; ++l)
+            {
+                uniform_real_distribution<double> distr(bk.lb[j * lanes + l], bk.ub[j * lanes + l]);
+                bk.x[(i * _dim + j) * lanes + l] = static_cast<Scalar>(distr(bk.engine));
+            }
+    _evaluate(bk, bk.x, bk.fom, bk.violation);
+    _update_best(bk);
+}
+void BatchDE::_generation(Block& bk)
+{
+    const size_t np  = _conf.np;
+    const size_t dim = _dim;
+    const Scalar f   = static_cast<Scalar>(_conf.f);
+    uniform_int_distribution<size_t> i_distr(0, np - 1);
+    uniform_int_distribution<size_t> j_distr(0, dim - 1);
+    uniform_real_distribution<double> prob(0, 1);
+    if (_conf.ms == Best1)
+    {
+        // the best of every lane gathered once into a contiguous base row
+        for (size_t j = 0; j < dim; ++j)
+            for (size_t l = 0; l < lanes; ++l)
+                bk.base[j * lanes + l] = bk.x[(bk.best[l] * dim + j) * lanes + l];
+    }
+    for (size_t i = 0; i < np; ++i)
+    {
+        // same draws as the built-in strategies, shared by the lanes of the block
+        size_t r1 = i_distr(bk.engine), r2, r3;
+        do
+            r2 = i_distr(bk.engine);
+        while (r2 == r1);
+        bk.redrawn.clear();
+        if (_conf.ms == Best1)
+        {
+            // the pair drawn above is the difference x_r2 - x_r3; like Mutator_Best_1 it excludes
+            // the best, so the lanes whose best is in it draw their own pair, which keeps every
+            // lane uniform over the pairs without its best
+            r3 = r2;
+            r2 = r1;
+            for (size_t l = 0; l < bk.count; ++l)
+            {
+                if (bk.best[l] != r2 && bk.best[l] != r3)
+                    continue;
+                size_t d1, d2;
+                do
+                    d1 = i_distr(bk.engine);
+                while (d1 == bk.best[l]);
+                do
+                    d2 = i_distr(bk.engine);
+                while (d2 == bk.best[l] || d2 == d1);
+                bk.redrawn.push_back(l);
+                bk.d1[l] = d1;
+                bk.d2[l] = d2;
+            }
+        }
+        else
+        {
+            do
+                r3 = i_distr(bk.engine);
+            while (r3 == r1 || r3 == r2);
+        }
+        if (_conf.cs == Bin)
+        {
+            const size_t rand_idx = j_distr(bk.engine);
+            for (size_t j = 0; j < dim; ++j)
+                bk.mask[j] = prob(bk.engine) <= _conf.cr || j == rand_idx;
+        }
+        else
+        {
+            size_t len = 1;
+            for (; prob(bk.engine) < _conf.cr && len < dim; ++len)
+                ;
+            const size_t start = j_distr(bk.engine);
+            fill(bk.mask.begin(), bk.mask.end(), 0);
+            for (size_t j = start; j < start + len; ++j)
+                bk.mask[j % dim] = 1;
+        }
+        for (size_t j = 0; j < dim; ++j)
+        {
+            const Scalar* cur = &bk.x[(i * dim + j) * lanes];
+            Scalar* t         = &bk.trial[(i * dim + j) * lanes];
+            if (!bk.mask[j])
+            {
+                copy(cur, cur + lanes, t);
+                continue;
+            }
+            const Scalar* a  = _conf.ms == Best1 ? &bk.base[j * lanes] : &bk.x[(r1 * dim + j) * lanes];
+            const Scalar* x2 = &bk.x[(r2 * dim + j) * lanes];
+            const Scalar* x3 = &bk.x[(r3 * dim + j) * lanes];
+#pragma omp simd
+            for (size_t l = 0; l < lanes; ++l)
+                t[l] = a[l] + f * (x2[l] - x3[l]);
+            for (size_t l : bk.redrawn)
+                t[l] = a[l] + f * (bk.x[(bk.d1[l] * dim + j) * lanes + l] - bk.x[(bk.d2[l] * dim + j) * lanes + l]);
+            // out of range coordinates are sampled again, like IMutator::boundary_constraint
+            const Scalar* lo = &bk.lb[j * lanes];
+            const Scalar* hi = &bk.ub[j * lanes];
+            for (size_t l = 0; l < bk.count; ++l)
+            {
+                if (!(lo[l] <= t[l] && t[l] <= hi[l]))
+                {
+                    uniform_real_distribution<double> distr(lo[l], hi[l]);
+                    t[l] = static_cast<Scalar>(distr(bk.engine));
+                }
+            }
+        }
+    }
+    _evaluate(bk, bk.trial, bk.trial_fom, bk.trial_violation);
+    for (size_t i = 0; i < np; ++i)
+    {
+        const double* tf = &bk.trial_fom[i * lanes];
+        const double* tv = &bk.trial_violation[i * lanes];
+        double* xf       = &bk.fom[i * lanes];
+        double* xv       = &bk.violation[i * lanes];
+        char* won        = bk.won.data();
+        if (_conf.ss == StaticPenalty)
+        {
+#pragma omp simd
+            for (size_t l = 0; l < lanes; ++l)
+                won[l] = tf[l] + tv[l] <= xf[l] + xv[l];
+        }
+        else
+        {
+#pragma omp simd
+            for (size_t l = 0; l < lanes; ++l)
+                won[l] = tv[l] < xv[l] || (tv[l] == xv[l] && tf[l] <= xf[l]);
+        }
+        for (size_t j = 0; j < dim; ++j)
+        {
+            Scalar* x       = &bk.x[(i * dim + j) * lanes];
+            const Scalar* t = &bk.trial[(i * dim + j) * lanes];
+#pragma omp simd
+            for (size_t l = 0; l < lanes; ++l)
+                x[l] = won[l] ? t[l] : x[l];
+        }
+#pragma omp simd
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            xf[l] = won[l] ? tf[l] : xf[l];
+            xv[l] = won[l] ? tv[l] : xv[l];
+        }
+    }
+    _update_best(bk);
+}
+void BatchDE::solver()
+{
+    for (size_t b = 0; b < _blocks.size(); ++b)
+    {
+        // one engine per block, so the draws don't depend on the thread running it
+        if (_conf.seeded)
+            _blocks[b].engine.seed(_conf.seed + 0x9E3779B97F4A7C15ULL * (b + 1));
+        else
+            _blocks[b].engine.seed(engine());
+    }
+    // the blocks are independent, every thread runs all generations of its blocks
+    exception_ptr error;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < static_cast<int>(_blocks.size()); ++b)
+    {
+        try
+        {
+            Block& bk = _blocks[b];
+            _init(bk);
+            for (size_t g = 1; g < _conf.max_iter; ++g)
+                _generation(bk);
+        }
+        catch (...)
+        {
+#pragma omp critical(batch_de_error)
+            error = current_exception();
+        }
+    }
+    if (error)
+        rethrow_exception(error);
+    _curr_gen    = _conf.max_iter;
+    _evaluations = _conf.np * _n * _conf.max_iter;
+}
+Solution BatchDE::best(size_t p) const
+{
+    const Block& bk = _blocks.at(p / lanes);
+    const size_t l  = p % lanes;
+    Solution x(_dim);
+    for (size_t j = 0; j < _dim; ++j)
+        x[j] = bk.x[(bk.best[l] * _dim + j) * lanes + l];
+    return x;
+}
+double BatchDE::best_fom(size_t p) const
+{
+    const Block& bk = _blocks.at(p / lanes);
+    return bk.fom[bk.best[p % lanes] * lanes + p % lanes];
+}
+double BatchDE::best_violation(size_t p) const
+{
+    const Block& bk = _blocks.at(p / lanes);
+    return bk.violation[bk.best[p % lanes] * lanes + p % lanes];
+}
@@ -0,0 +1,292 @@
+#include "DE/Coevolution.h"
+#include "DE/DERandomF.h"
+#include "DE/SaDE.h"
+#include "global.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <atomic>
+#include <functional>
+#include <cmath>
+using namespace std;
+namespace
+{
+template <typename Enum>
+string lut_name(const unordered_map<string, Enum>& lut, Enum val)
+{
+    for (const auto& kv : lut)
+        if (kv.second == val)
+            return kv.first;
+    return "?";
+}
+pair<double, double> key_of(const Evaluated& e)
+{
+    return make_pair(accumulate(e.second.begin(), e.second.end(), 0.0), e.first);
+}
+// versions are unique across instances, a thread-local copy of any older context is stale
+atomic<size_t> context_versions(0);
+// union-find root with path halving
+size_t root(vector<size_t>& parent, size_t i)
+{
+    while (parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+}
+Coevolution::Coevolution(Objective func, const Ranges& rg, const DEConfig& conf)
+    : _func(func), _ranges(rg), _conf(conf), _version(0), _slots(0), _grouping_evals(0), _context_evals(0),
+      _log(&cout)
+{
+    _conf.validate();
+    if (_ranges.empty())
+        throw ConfigError("Empty ranges");
+}
+Coevolution::~Coevolution()
+{
+}
+size_t Coevolution::evaluations() const noexcept
+{
+    size_t n = _grouping_evals + _context_evals;
+    for (const auto& de : _subs)
+        n += de->scheduler().evaluations();
+    return n;
+}
+Evaluated Coevolution::_evaluate_group(size_t g, size_t i, const Solution& y) const
+{
+    // the full solution is kept per thread and only the group's coordinates are written and
+    // restored, a generation doesn't copy the whole context for every trial
+    struct Scratch
+    {
+        size_t version = 0;
+        Solution x;
+    };
+    thread_local Scratch s;
+    if (s.version != _version)
+        s.x = _context;
+    s.version                    = 0; // dirty until restored, in case the objective throws
+    const vector<size_t>& group = _groups[g];
+    for (size_t j = 0; j < group.size(); ++j)
+        s.x[group[j]] = y[j];
+    Evaluated r = _func(g * _slots + i, s.x); // disjoint index ranges of the concurrent sub-populations
+    for (size_t j : group)
+        s.x[j] = _context[j];
+    s.version = _version;
+    return r;
+}
+void Coevolution::_random_grouping()
+{
+    vector<size_t> order(_ranges.size());
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), engine);
+    const size_t size = _conf.coevolution.group_size;
+    for (size_t b = 0; b < order.size(); b += size)
+    {
+        vector<size_t> group(order.begin() + b, order.begin() + min(order.size(), b + size));
+        sort(group.begin(), group.end());
+        _groups.push_back(group);
+    }
+}
+void Coevolution::_differential_grouping()
+{
+    // x_i and x_j interact if moving both from the lower bounds to the middle of their ranges changes
+    // the FOM by more than the sum of the single moves: f(x_ij) - f(x_j) != f(x_i) - f(x_0)
+    const size_t n = _ranges.size();
+    Solution base(n), mid(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        base[j] = _ranges[j].first;
+        mid[j]  = 0.5 * (_ranges[j].first + _ranges[j].second);
+    }
+    const double f0 = _func(0, base).first;
+    vector<double> fi(n);
+    vector<vector<size_t>> edges(n);
+    // the probes are evaluated under the index of their worker slot, below NP like every index the
+    // objective gets, and no two running probes share one; the slots take the next row when done
+    const size_t slots = max<size_t>(1, min(_conf.np, n));
+    atomic<size_t> next_row(0);
+    auto run_rows = [&](const function<void(size_t slot, size_t i)>& row) {
+        next_row.store(0);
+        ThreadPool::instance().run(slots, [&](size_t slot) {
+            for (size_t i = next_row++; i < n; i = next_row++)
+                row(slot, i);
+        });
+    };
+    run_rows([&](size_t slot, size_t i) {
+        Solution x = base;
+        x[i]       = mid[i];
+        fi[i]      = _func(slot, x).first;
+    });
+    const double eps = _conf.coevolution.dg_epsilon;
+    // one row of pairs at a time, the rows are uneven
+    run_rows([&](size_t slot, size_t i) {
+        Solution x = base;
+        x[i]       = mid[i];
+        for (size_t j = i + 1; j < n; ++j)
+        {
+            x[j]              = mid[j];
+            const double fij  = _func(slot, x).first;
+            x[j]              = base[j];
+            const double diff = (fij - fi[j]) - (fi[i] - f0);
+            if (fabs(diff) > eps * (fabs(f0) + fabs(fi[i]) + fabs(fi[j]) + fabs(fij)))
+                edges[i].push_back(j);
+        }
+    });
+    _grouping_evals = 1 + n + n * (n - 1) / 2;
+    vector<size_t> parent(n);
+    iota(parent.begin(), parent.end(), 0);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j : edges[i])
+            parent[root(parent, i)] = root(parent, j);
+    // components in the order of their first variable; the large ones are groups of their own,
+    // the small ones and the separable variables are packed up to `group_size`
+    vector<vector<size_t>> components(n);
+    for (size_t i = 0; i < n; ++i)
+        components[root(parent, i)].push_back(i);
+    sort(components.begin(), components.end(), [](const vector<size_t>& a, const vector<size_t>& b) {
+        return !a.empty() && (b.empty() || a[0] < b[0]);
+    });
+    const size_t size = _conf.coevolution.group_size;
+    vector<size_t> packed;
+    for (const auto& c : components)
+    {
+        if (c.empty())
+            break;
+        if (c.size() >= size)
+        {
+            _groups.push_back(c);
+            continue;
+        }
+        if (packed.size() + c.size() > size)
+        {
+            _groups.push_back(packed);
+            packed.clear();
+        }
+        packed.insert(packed.end(), c.begin(), c.end());
+    }
+    if (!packed.empty())
+        _groups.push_back(packed);
+}
+Solution Coevolution::solver()
+{
+    if (_conf.seeded)
+        engine.seed(_conf.seed);
+    _groups.clear();
+    _subs.clear();
+    _curve.clear();
+    _grouping_evals = 0;
+    _context_evals  = 0;
+    if (_conf.coevolution.grouping == DifferentialGrouping)
+        _differential_grouping();
+    else
+        _random_grouping();
+
+    DEConfig sub_conf       = _conf;
+    sub_conf.max_iter       = _conf.coevolution.generations;
+    sub_conf.numa           = false;
+    sub_conf.restart        = RestartConfig();
+    if (sub_conf.schedule != LongestFirst)
+        sub_conf.schedule = WorkStealing; // interleave the sub-populations on the shared pool
+    for (size_t g = 0; g < _groups.size(); ++g)
+    {
+        Ranges sub_ranges;
+        for (size_t j : _groups[g])
+            sub_ranges.push_back(_ranges[j]);
+        Objective sub = [this, g](const size_t i, const Solution& y) -> Evaluated { return _evaluate_group(g, i, y); };
+        DE* de        = nullptr;
+        switch (_conf.variant)
+        {
+            case Origin:
+                de = new DE(sub, sub_ranges, sub_conf);
+                break;
+            case RandomF:
+                de = new DERandomF(sub, sub_ranges, sub_conf);
+                break;
+            case SelfAdaptive:
+                de = new SaDE(sub, sub_ranges, sub_conf);
+                break;
+            default:
+                throw ConfigError("Unrecognized DE variant");
+        }
+        _subs.emplace_back(de);
+        _subs.back()->set_log(nullptr);
+        _slots = max(_slots, de->slots());
+    }
+
+    _context.resize(_ranges.size());
+    for (size_t j = 0; j < _ranges.size(); ++j)
+    {
+        uniform_real_distribution<double> distr(_ranges[j].first, _ranges[j].second);
+        _context[j] = distr(engine);
+    }
+    _context_result = _func(0, _context);
+    _context_evals  = 1;
+    _version        = ++context_versions;
+    for (size_t c = 0; c < _conf.coevolution.cycles; ++c)
+    {
+        _cycle(c);
+        _curve.push_back(_context_result.first);
+        if (_log != nullptr)
+            *_log << "Cycle: " << c << ", Best FOM: " << _context_result.first
+                  << ", Constraint Violation: " << key_of(_context_result).first << endl;
+    }
+    return _context;
+}
+void Coevolution::_cycle(size_t c)
+{
+    ThreadPool::instance().run(_subs.size(), [&](size_t g) {
+        DE& de = *_subs[g];
+        if (_conf.seeded)
+            de.set_seed(_conf.seed + 1 + c * _subs.size() + g);
+        if (c > 0)
+            de.set_initial_population(de.population()); // re-evaluated against the new context
+        de.solver();
+    });
+    // every group best was evaluated against the current context, the merge of all of them is
+    // evaluated once more
+    Solution merged = _context;
+    size_t best     = _subs.size(); // none: keep the context
+    pair<double, double> best_key = key_of(_context_result);
+    for (size_t g = 0; g < _subs.size(); ++g)
+    {
+        const DE& de      = *_subs[g];
+        const size_t b    = de.find_best();
+        const Solution& y = de.population()[b];
+        for (size_t j = 0; j < _groups[g].size(); ++j)
+            merged[_groups[g][j]] = y[j];
+        if (key_of(de.evaluated()[b]) < best_key)
+        {
+            best     = g;
+            best_key = key_of(de.evaluated()[b]);
+        }
+    }
+    Evaluated merged_result = _func(0, merged);
+    ++_context_evals;
+    if (key_of(merged_result) <= best_key)
+    {
+        _context.swap(merged);
+        _context_result = merged_result;
+    }
+    else if (best != _subs.size())
+    {
+        const DE& de      = *_subs[best];
+        const size_t b    = de.find_best();
+        const Solution& y = de.population()[b];
+        for (size_t j = 0; j < _groups[best].size(); ++j)
+            _context[_groups[best][j]] = y[j];
+        _context_result = de.evaluated()[b];
+    }
+    _version = ++context_versions;
+}
+void Coevolution::report(ostream& os) const
+{
+    size_t smallest = _groups.empty() ? 0 : _ranges.size(), largest = 0;
+    for (const auto& g : _groups)
+    {
+        smallest = min(smallest, g.size());
+        largest  = max(largest, g.size());
+    }
+    os << "Cooperative coevolution: " << _groups.size() << " groups of " << smallest << " to " << largest
+       << " variables, " << lut_name(gm_lut, _conf.coevolution.grouping) << " grouping (" << _grouping_evals
+       << " probe evaluations), cycles: " << _curve.size() << ", evaluations: " << evaluations()
+       << ", best FOM: " << _context_result.first << ", violation: " << key_of(_context_result).first << endl;
+}
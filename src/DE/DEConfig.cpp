@@ -0,0 +1,275 @@
+#include "DE/DEConfig.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+using namespace std;
+namespace
+{
+string trim(const string& s)
+{
+    const size_t b = s.find_first_not_of(" \t\r\n");
+    const size_t e = s.find_last_not_of(" \t\r\n");
+    return b == string::npos ? "" : s.substr(b, e - b + 1);
+}
+double to_number(const string& key, const string& val)
+{
+    char* end       = nullptr;
+    const double v  = strtod(val.c_str(), &end);
+    if (val.empty() || *end != '\0')
+        throw ConfigError("Invalid number for " + key + ": " + val);
+    return v;
+}
+size_t to_count(const string& key, double v)
+{
+    if (v < 0 || v != floor(v))
+        throw ConfigError(key + " should be a non-negative integer");
+    return static_cast<size_t>(v);
+}
+template <typename Enum>
+Enum lookup(const unordered_map<string, Enum>& lut, const string& key, const string& val)
+{
+    auto iter = lut.find(val);
+    if (iter == lut.end())
+        throw ConfigError("Unrecognized " + key + ": " + val);
+    return iter->second;
+}
+template <typename Enum>
+Enum to_enum(const string& key, double v, Enum last)
+{
+    if (v < 0 || v > static_cast<double>(last) || v != floor(v))
+        throw ConfigError("Unrecognized " + key + ": " + to_string(v));
+    return static_cast<Enum>(static_cast<int>(v));
+}
+// set one numeric parameter, other keys are only kept in `extra`
+void set_number(DEConfig& c, const string& key, double v)
+{
+    if (key == "variant")               c.variant             = to_enum(key, v, SelfAdaptive);
+    else if (key == "mutation")         c.ms                  = to_enum(key, v, RandToBest2);
+    else if (key == "crossover")        c.cs                  = to_enum(key, v, Eigen);
+    else if (key == "selection")        c.ss                  = to_enum(key, v, Epsilon);
+    else if (key == "f")                c.f                   = v;
+    else if (key == "cr")               c.cr                  = v;
+    else if (key == "np")               c.np                  = to_count(key, v);
+    else if (key == "max_iter")         c.max_iter            = to_count(key, v);
+    else if (key == "min_valid_num")    c.min_valid_num       = to_count(key, v);
+    else if (key == "seed")
+    {
+        c.seeded = true;
+        c.seed   = to_count(key, v);
+    }
+    else if (key == "eval_schedule" || key == "schedule")
+                                        c.schedule            = to_enum(key, v, NumaOwner);
+    else if (key == "eval_chunk")       c.eval_chunk          = to_count(key, v);
+    else if (key == "numa")             c.numa                = v != 0;
+    else if (key == "numa_threads")     c.numa_threads        = to_count(key, v);
+    else if (key == "theta")            c.epsilon.theta       = v;
+    else if (key == "cp")               c.epsilon.cp          = v;
+    else if (key == "tc")               c.epsilon.tc          = to_count(key, v);
+    else if (key == "lp")               c.sade.lp             = to_count(key, v);
+    else if (key == "fmu")              c.sade.fmu            = v;
+    else if (key == "fsigma")
+    {
+        c.fsigma      = v;
+        c.sade.fsigma = v;
+    }
+    else if (key == "crmu")             c.sade.crmu           = v;
+    else if (key == "crsigma")          c.sade.crsigma        = v;
+    else if (key == "surrogate")        c.surrogate.enabled   = v != 0;
+    else if (key == "surrogate_k")      c.surrogate.k         = to_count(key, v);
+    else if (key == "surrogate_explore")     c.surrogate.explore     = v;
+    else if (key == "surrogate_min_archive") c.surrogate.min_archive = to_count(key, v);
+    else if (key == "surrogate_max_archive") c.surrogate.max_archive = to_count(key, v);
+    else if (key == "repair_prob")      c.repair.prob         = v;
+    else if (key == "repair_steps")     c.repair.steps        = to_count(key, v);
+    else if (key == "repair_fd_step")   c.repair.fd_step      = v;
+    else if (key == "restarts")         c.restart.max_restarts = to_count(key, v);
+    else if (key == "restart_growth")   c.restart.growth      = v;
+    else if (key == "restart_stall")    c.restart.stall       = to_count(key, v);
+    else if (key == "restart_tol")      c.restart.tol         = v;
+    else if (key == "restart_max_np")   c.restart.max_np      = to_count(key, v);
+    else if (key == "budget")           c.restart.budget      = to_count(key, v);
+    else if (key == "local_search")
+    {
+        c.local_search.enabled = true;
+        c.local_search.method  = to_enum(key, v, QuasiNewton);
+    }
+    else if (key == "ls_period")        c.local_search.period    = to_count(key, v);
+    else if (key == "ls_top_k")         c.local_search.top_k     = to_count(key, v);
+    else if (key == "ls_evals")         c.local_search.max_evals = to_count(key, v);
+    else if (key == "ls_share")         c.local_search.share     = v;
+    else if (key == "ls_fd_step")       c.local_search.fd_step   = v;
+    else if (key == "ls_tol")           c.local_search.tol       = v;
+    else if (key == "mf_promotion")     c.fidelity.promotion     = to_enum(key, v, PromoteEither);
+    else if (key == "mf_top_fraction")  c.fidelity.top_fraction  = v;
+    else if (key == "mf_margin")        c.fidelity.margin        = v;
+    else if (key == "cc_grouping")      c.coevolution.grouping    = to_enum(key, v, DifferentialGrouping);
+    else if (key == "cc_group_size")    c.coevolution.group_size  = to_count(key, v);
+    else if (key == "cc_cycles")        c.coevolution.cycles      = to_count(key, v);
+    else if (key == "cc_generations")   c.coevolution.generations = to_count(key, v);
+    else if (key == "cc_epsilon")       c.coevolution.dg_epsilon  = v;
+    else if (key == "eig_period")       c.eigen.period            = to_count(key, v);
+    else if (key == "eig_prob")         c.eigen.prob              = v;
+    else if (key == "eig_max_dim")      c.eigen.max_dim           = to_count(key, v);
+}
+template <typename Map>
+void mark_given(DEConfig& c, const Map& m)
+{
+    c.epsilon.given = m.count("theta") && m.count("cp") && m.count("tc");
+    c.sade.given    = m.count("lp") && m.count("fmu") && m.count("fsigma") && m.count("crmu") && m.count("crsigma");
+}
+}
+void DEConfig::validate() const
+{
+    if (np < 4)
+        throw ConfigError("np should be at least 4");
+    if (max_iter < 1)
+        throw ConfigError("max_iter should be positive");
+    if (min_valid_num > np)
+        throw ConfigError("min_valid_num should not exceed np");
+    if (cr < 0 || cr > 1)
+        throw ConfigError("cr should be in [0, 1]");
+    if (fsigma < 0)
+        throw ConfigError("fsigma should be non-negative");
+    if (ss == Epsilon)
+    {
+        if (!epsilon.given)
+            throw ConfigError("The epsilon selector requires theta, cp and tc");
+        if (epsilon.theta <= 0 || epsilon.theta > 1)
+            throw ConfigError("theta should be in (0, 1]");
+        if (static_cast<size_t>(np * epsilon.theta) == 0)
+            throw ConfigError("np * theta should be at least 1");
+    }
+    if (variant == SelfAdaptive)
+    {
+        if (!sade.given)
+            throw ConfigError("SaDE requires lp, fmu, fsigma, crmu and crsigma");
+        if (sade.lp == 0)
+            throw ConfigError("lp should be positive");
+        if (sade.fsigma < 0 || sade.crsigma < 0)
+            throw ConfigError("fsigma and crsigma should be non-negative");
+    }
+    if (surrogate.enabled)
+    {
+        if (surrogate.k == 0)
+            throw ConfigError("surrogate_k should be positive");
+        if (surrogate.explore < 0 || surrogate.explore > 1)
+            throw ConfigError("surrogate_explore should be in [0, 1]");
+    }
+    if (schedule == NumaOwner && !numa)
+        throw ConfigError("The numa-owner schedule requires numa = 1");
+    if (restart.growth < 1)
+        throw ConfigError("restart_growth should be at least 1");
+    if (restart.stall == 0)
+        throw ConfigError("restart_stall should be positive");
+    if (restart.tol < 0)
+        throw ConfigError("restart_tol should be non-negative");
+    if (restart.max_np != 0 && restart.max_np < np)
+        throw ConfigError("restart_max_np should not be less than np");
+    if (repair.prob < 0 || repair.prob > 1)
+        throw ConfigError("repair_prob should be in [0, 1]");
+    if (repair.fd_step <= 0)
+        throw ConfigError("repair_fd_step should be positive");
+    if (local_search.enabled)
+    {
+        if (local_search.period == 0)
+            throw ConfigError("ls_period should be positive");
+        if (local_search.top_k == 0 || local_search.top_k > np)
+            throw ConfigError("ls_top_k should be in [1, np]");
+        if (local_search.share <= 0 || local_search.share >= 1)
+            throw ConfigError("ls_share should be in (0, 1)");
+        if (local_search.fd_step <= 0)
+            throw ConfigError("ls_fd_step should be positive");
+        if (local_search.tol < 0)
+            throw ConfigError("ls_tol should be non-negative");
+    }
+    if (fidelity.top_fraction < 0 || fidelity.top_fraction > 1)
+        throw ConfigError("mf_top_fraction should be in [0, 1]");
+    if (fidelity.promotion == PromoteTop && fidelity.top_fraction == 0)
+        throw ConfigError("mf_top_fraction should be positive with the top promotion");
+    if (fidelity.margin < 0)
+        throw ConfigError("mf_margin should be non-negative");
+    if (coevolution.group_size == 0)
+        throw ConfigError("cc_group_size should be positive");
+    if (coevolution.cycles == 0 || coevolution.generations == 0)
+        throw ConfigError("cc_cycles and cc_generations should be positive");
+    if (coevolution.dg_epsilon < 0)
+        throw ConfigError("cc_epsilon should be non-negative");
+    if (eigen.period == 0)
+        throw ConfigError("eig_period should be positive");
+    if (eigen.prob < 0 || eigen.prob > 1)
+        throw ConfigError("eig_prob should be in [0, 1]");
+}
+DEConfig DEConfig::from_map(const unordered_map<string, double>& m)
+{
+    DEConfig c;
+    for (const auto& kv : m)
+        set_number(c, kv.first, kv.second);
+    mark_given(c, m);
+    c.extra = m; // user-defined strategies may read any key
+    return c;
+}
+DEConfig DEConfig::from_strings(const unordered_map<string, string>& m)
+{
+    DEConfig c;
+    for (const auto& kv : m)
+    {
+        const string& key = kv.first;
+        const string& val = kv.second;
+        if (key == "variant")
+            c.variant = lookup(dv_lut, key, val);
+        else if (key == "mutation")
+            c.ms = lookup(ms_lut, key, val);
+        else if (key == "crossover")
+            c.cs = lookup(cs_lut, key, val);
+        else if (key == "selection")
+            c.ss = lookup(ss_lut, key, val);
+        else if (key == "schedule")
+            c.schedule = lookup(sp_lut, key, val);
+        else if (key == "local_search")
+        {
+            c.local_search.enabled = true;
+            c.local_search.method  = lookup(ls_lut, key, val);
+        }
+        else if (key == "mf_promotion")
+            c.fidelity.promotion = lookup(pp_lut, key, val);
+        else if (key == "cc_grouping")
+            c.coevolution.grouping = lookup(gm_lut, key, val);
+        else
+        {
+            const double v = to_number(key, val);
+            set_number(c, key, v);
+            c.extra[key] = v;
+        }
+    }
+    mark_given(c, m);
+    return c;
+}
+DEConfig DEConfig::from_file(const string& path)
+{
+    return from_strings(read_file(path));
+}
+unordered_map<string, string> DEConfig::read_file(const string& path)
+{
+    ifstream ifs(path);
+    if (!ifs)
+        throw ConfigError("Can't open config file " + path);
+    unordered_map<string, string> m;
+    string line;
+    size_t line_no = 0;
+    while (getline(ifs, line))
+    {
+        ++line_no;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        const size_t eq = line.find('=');
+        if (eq == string::npos)
+            throw ConfigError(path + ":" + to_string(line_no) + ": expected key = value");
+        const string key = trim(line.substr(0, eq));
+        if (key.empty())
+            throw ConfigError(path + ":" + to_string(line_no) + ": empty key");
+        m[key] = trim(line.substr(eq + 1));
+    }
+    return m;
+}
@@ -9,65 +9,226 @@
 #include <cassert>
 #include <numeric>
 #include <string>
+#include <cmath>
+#include <limits>
+#include <chrono>
 using namespace std;
-DE::DE(Objective func, const Ranges& rg, MutationStrategy ms,
-       CrossoverStrategy cs, SelectionStrategy ss, double f, double cr,
-       size_t np, size_t max_iter, unordered_map<string, double> extra)
+namespace
+{
+const unsigned low_objective = 1; // cache objective index of the low fidelity
+DEConfig legacy_config(const unordered_map<string, double>& extra, MutationStrategy ms, CrossoverStrategy cs,
+                       SelectionStrategy ss, double f, double cr, size_t np, size_t max_iter)
+{
+    DEConfig conf = DEConfig::from_map(extra);
+    conf.ms       = ms;
+    conf.cs       = cs;
+    conf.ss       = ss;
+    conf.f        = f;
+    conf.cr       = cr;
+    conf.np       = np;
+    conf.max_iter = max_iter;
+    return conf;
+}
+}
+DE::DE(Objective func, const Ranges& rg, const DEConfig& conf)
     : _func(func),
       _ranges(rg),
-      _f(f),
-      _cr(cr),
-      _np(np),
+      _conf(conf),
+      _f(conf.f),
+      _cr(conf.cr),
+      _np(conf.np),
       _dim(rg.size()),
-      _max_iter(max_iter),
-      _extra_conf(extra),
+      _max_iter(conf.max_iter),
+      _extra_conf(conf.extra),
       _curr_gen(0),
-      _use_built_in_strategy(true)
+      _mutator(nullptr),
+      _crossover(nullptr),
+      _selector(nullptr),
+      _use_built_in_strategy(true),
+      _log(&cout),
+      _seeded(false),
+      _seed(0),
+      _stopped(false)
 {
-    _mutator   = set_mutator(ms, extra);
-    _crossover = set_crossover(cs, extra);
-    _selector  = set_selector(ss, extra);
+    _configure();
+    _mutator   = set_mutator(_conf.ms, _conf);
+    _crossover = set_crossover(_conf.cs, _conf);
+    _selector  = set_selector(_conf.ss, _conf);
 }
-DE::DE(Objective func, const Ranges& rg, IMutator* m, ICrossover* c,
-       ISelector* s, double f, double cr, size_t np, size_t max_iter,
-       unordered_map<string, double> extra)
+DE::DE(Objective func, const Ranges& rg, const DEConfig& conf, IMutator* m, ICrossover* c, ISelector* s)
     : _func(func),
       _ranges(rg),
-      _f(f),
-      _cr(cr),
-      _np(np),
+      _conf(conf),
+      _f(conf.f),
+      _cr(conf.cr),
+      _np(conf.np),
       _dim(rg.size()),
-      _max_iter(max_iter),
-      _extra_conf(extra),
+      _max_iter(conf.max_iter),
+      _extra_conf(conf.extra),
       _curr_gen(0),
       _mutator(m),
       _crossover(c),
       _selector(s),
-      _use_built_in_strategy(false)
+      _use_built_in_strategy(false),
+      _log(&cout),
+      _seeded(false),
+      _seed(0),
+      _stopped(false)
 {
+    _configure();
+}
+DE::DE(Objective func, const Ranges& rg, MutationStrategy ms,
+       CrossoverStrategy cs, SelectionStrategy ss, double f, double cr,
+       size_t np, size_t max_iter, unordered_map<string, double> extra)
+    : DE(func, rg, legacy_config(extra, ms, cs, ss, f, cr, np, max_iter))
+{
+}
+DE::DE(Objective func, const Ranges& rg, IMutator* m, ICrossover* c,
+       ISelector* s, double f, double cr, size_t np, size_t max_iter,
+       unordered_map<string, double> extra)
+    : DE(func, rg, legacy_config(extra, Best1, Bin, StaticPenalty, f, cr, np, max_iter), m, c, s)
+{
+}
+void DE::_configure()
+{
+    _conf.validate();
+    if (_dim == 0)
+        throw ConfigError("Empty ranges");
+    for (const auto& rg : _ranges)
+    {
+        if (!(rg.first <= rg.second))
+            throw ConfigError("Invalid range [" + to_string(rg.first) + ", " + to_string(rg.second) + "]");
+    }
+    set_schedule_policy(_conf.schedule, _conf.eval_chunk);
+    _metrics.attach(&_scheduler);
+    _fidelity          = _conf.fidelity;
+    _fidelity_trials   = 0;
+    _fidelity_promoted = 0;
+    for (size_t l = 0; l < NumFidelities; ++l)
+    {
+        _fidelity_evals[l].store(0);
+        _fidelity_ns[l].store(0);
+    }
+    if (_conf.seeded)
+        set_seed(_conf.seed);
+    if (_conf.surrogate.enabled)
+        enable_surrogate(_conf.surrogate.k, _conf.surrogate.explore, _conf.surrogate.min_archive,
+                         _conf.surrogate.max_archive);
+    if (_conf.repair.prob != 0)
+        enable_gradient_repair(_conf.repair.prob, _conf.repair.steps, _conf.repair.fd_step);
+    if (_conf.numa)
+        enable_numa(_conf.numa_threads);
+    if (_conf.local_search.enabled)
+        enable_local_search(_conf.local_search);
 }
 Solution DE::solver()
 {
-    init();
-    for (_curr_gen = 1; _curr_gen < _max_iter; ++_curr_gen)
+    _metrics.start();
+    {
+        PhaseTimer t(_metrics, PhaseInit);
+        init();
+    }
+    _curr_gen = 1;
+    return evolve();
+}
+Solution DE::resume()
+{
+    if (!_stopped)
+        throw ConfigError("resume needs a solver stopped by the generation callback");
+    engine = _stopped_engine;
+    _metrics.set_running(true);
+    ++_curr_gen;
+    return evolve();
+}
+Solution DE::evolve()
+{
+    _stopped = false;
+    for (; _curr_gen < _max_iter; ++_curr_gen)
     {
-        auto doners = _mutator->mutation(*this);
-        auto trials = _crossover->crossover(*this, _population, doners);
-        vector<Evaluated> trial_results(_np);
-#pragma omp parallel for
-		// OpenMP 2.0 doesn't allow unsigned for loop index!
-        for (int p_idx = 0; p_idx < (int)_population.size(); ++p_idx)
+        // the donors, trials and their results live in the arena sized by `init`, the loop
+        // itself allocates no rows
+        if (_crossover->sparse())
+        {
+            // trials are kept as deltas to their targets, winners patch only the changed coordinates
+            {
+                PhaseTimer t(_metrics, PhaseVariation);
+                // positions first, then the donor at those coordinates only: O(CR * dim) per trial
+                auto vary_at = [&](size_t i) {
+                    _crossover->sample_positions(*this, i, _sparse_trials[i]);
+                    _mutator->mutate_at(*this, i, _sparse_trials[i].index, _sparse_trials[i].value);
+                };
+                const bool per_target = _mutator->per_target();
+                if (per_target && _crossover->samples_positions() && _numa)
+                    _numa->run(_np, vary_at);
+                else if (per_target && _crossover->samples_positions())
+                {
+                    for (size_t i = 0; i < _np; ++i)
+                        vary_at(i);
+                }
+                else if (per_target && _numa)
+                    _numa->run(_np, [&](size_t i) {
+                        _mutator->mutate_into(*this, i, _doners[i]);
+                        _crossover->crossover_sparse(*this, i, _population[i], _doners[i], _sparse_trials[i]);
+                    });
+                else
+                {
+                    _mutator->mutate_all(*this, _doners);
+                    for (size_t i = 0; i < _np; ++i)
+                        _crossover->crossover_sparse(*this, i, _population[i], _doners[i], _sparse_trials[i]);
+                }
+            }
+            {
+                PhaseTimer t(_metrics, PhaseEvaluation);
+                evaluate(_sparse_trials, _trial_results);
+            }
+            {
+                PhaseTimer t(_metrics, PhaseSelection);
+                _selector->select_sparse(*this, _population, _results, _sparse_trials, _trial_results);
+                _crossover->population_changed(*this, nullptr, _population); // the old coordinates are gone
+            }
+            if (!end_generation())
+                break;
+            continue;
+        }
         {
-            trial_results[p_idx] = _func(p_idx, trials[p_idx]);
+            PhaseTimer t(_metrics, PhaseVariation);
+            if (_numa && _mutator->per_target() && _crossover->per_target())
+                _numa->run(_np, [&](size_t i) {
+                    _mutator->mutate_into(*this, i, _doners[i]);
+                    _crossover->crossover_into(*this, _population[i], _doners[i], _trials[i]);
+                });
+            else
+            {
+                // all donors first, so the random numbers are drawn in the same order as before;
+                // user strategies go through their batch methods
+                _mutator->mutate_all(*this, _doners);
+                _crossover->crossover_all(*this, _population, _doners, _trials);
+            }
         }
-        auto new_result = _selector->select(*this, _population, trials,
-                                            _results, trial_results);
-        copy(new_result.first.begin(), new_result.first.end(),
-             _results.begin());
-        copy(new_result.second.begin(), new_result.second.end(),
-             _population.begin());
-        report_best();
+        {
+            PhaseTimer t(_metrics, PhaseEvaluation);
+            if (_surrogate && _surrogate->ready())
+                screened_evaluate(_trials, _trial_results);
+            else
+            {
+                evaluate_trials(_trials, _trial_results, _all);
+                for (size_t k = 0; _surrogate && k < _full.size(); ++k)
+                    _surrogate->add(*this, _trials[_full[k]], _trial_results[_full[k]]);
+            }
+        }
+        {
+            PhaseTimer t(_metrics, PhaseRepair);
+            repair(_trials, _trial_results);
+        }
+        {
+            PhaseTimer t(_metrics, PhaseSelection);
+            _selector->select_inplace(*this, _population, _results, _trials, _trial_results);
+            _crossover->population_changed(*this, _selector->replaced(), _trials);
+        }
+        if (!end_generation())
+            break;
     }
+    _metrics.set_running(false);
     size_t best_idx = find_best();
     return _population[best_idx];
 }
@@ -81,7 +242,7 @@ DE::~DE()
         delete _selector;
     }
 }
-IMutator* DE::set_mutator(MutationStrategy ms, const unordered_map<string, double>&) const noexcept
+IMutator* DE::set_mutator(MutationStrategy ms, const DEConfig&) const
 {
     IMutator* mutator;
     switch (ms)
@@ -108,28 +269,26 @@ IMutator* DE::set_mutator(MutationStrategy ms, const unordered_map<string, doubl
             mutator = new Mutator_RandToBest_2;
             break;
         default:
-            mutator = nullptr;
-            cerr << "Unrecognoized Mutation Strategy" << endl;
-            exit(EXIT_FAILURE);
+            throw ConfigError("Unrecognoized Mutation Strategy");
     }
     return mutator;
 }
-ICrossover* DE::set_crossover(CrossoverStrategy cs, const unordered_map<string, double>&) const noexcept
+ICrossover* DE::set_crossover(CrossoverStrategy cs, const DEConfig& config) const
 {
     ICrossover* crossover;
     if (cs == CrossoverStrategy::Bin)
         crossover = new Crossover_Bin;
     else if (cs == CrossoverStrategy::Exp)
         crossover = new Crossover_Exp;
+    else if (cs == CrossoverStrategy::SparseBin)
+        crossover = new Crossover_SparseBin;
+    else if (cs == CrossoverStrategy::Eigen)
+        crossover = new Crossover_Eigen(config.eigen.period, config.eigen.prob, config.eigen.max_dim);
     else
-    {
-        crossover = nullptr;
-        cerr << "Unrecognoized Crossover Strategy" << endl;
-        exit(EXIT_FAILURE);
-    }
+        throw ConfigError("Unrecognoized Crossover Strategy");
     return crossover;
 }
-ISelector* DE::set_selector(SelectionStrategy ss, const unordered_map<string, double>& config) const noexcept
+ISelector* DE::set_selector(SelectionStrategy ss, const DEConfig& config) const
 {
     ISelector* selector;
     if (ss == SelectionStrategy::StaticPenalty)
@@ -138,71 +297,554 @@ ISelector* DE::set_selector(SelectionStrategy ss, const unordered_map<string, do
         selector = new Selector_FeasibilityRule;
     else if (ss == SelectionStrategy::Epsilon)
     {
-        for (string name : vector<string>{"theta", "tc", "cp"})
-        {
-            if (config.find(name) == config.end())
-            {
-                cerr << "Can't find " << name << " in extra confg" << endl;
-                exit(EXIT_FAILURE);
-            }
-        }
-        double theta = config.find("theta")->second;
-        double cp    = config.find("cp")->second;
-        size_t tc    = (size_t)config.find("tc")->second;
-        selector = new Selector_Epsilon(theta, cp, tc);
+        if (!config.epsilon.given)
+            throw ConfigError("The epsilon selector requires theta, cp and tc");
+        selector = new Selector_Epsilon(config.epsilon.theta, config.epsilon.cp, config.epsilon.tc);
     }
     else
-    {
-        selector = nullptr;
-        cerr << "Unrecognoized Selection Strategy" << endl;
-        exit(EXIT_FAILURE);
-    }
+        throw ConfigError("Unrecognoized Selection Strategy");
     return selector;
 }
 void DE::init()
 {
+    _stopped = false;
+    if (_local_search)
+        _local_search->reset();
+    if (_seeded)
+        engine.seed(_seed);
+    if (_seeded && _numa)
+        _numa->run(_numa->size(), [&](size_t t) { engine.seed(_seed + 1 + t); });
     // rate of populations with non-infinity constraint violationss
-    _population = vector<Solution>(_np, vector<double>(_dim, 0));
-    _results = vector<Evaluated>(_np);
-    size_t min_valid_num =
-        _extra_conf.find("min_valid_num") == _extra_conf.end()
-            ? 1
-            : (size_t)_extra_conf.find("min_valid_num")->second;
+    if (_numa)
+    {
+        _population.assign(_np, Solution());
+        _doners.assign(_np, Solution());
+        _trials.assign(_np, Solution());
+        _numa->run(_np, [&](size_t i) {
+            _population[i].assign(_dim, 0);
+            _doners[i].assign(_dim, 0);
+            _trials[i].assign(_dim, 0);
+        });
+    }
+    else
+    {
+        // rows of a previous run are reused
+        _population.resize(_np, Solution(_dim, 0));
+        _doners.resize(_np, Solution(_dim, 0));
+        _trials.resize(_np, Solution(_dim, 0));
+    }
+    _results.resize(_np);
+    _trial_results.resize(_np);
+    _sparse_trials.resize(_np);
+    for (size_t i = 0; _crossover && _crossover->sparse() && i < _np; ++i)
+    {
+        // a trial changes at most all coordinates, so the deltas never grow later
+        _sparse_trials[i].index.reserve(_dim);
+        _sparse_trials[i].value.reserve(_dim);
+    }
+    _all.resize(_np);
+    _kept.resize(_np);
+    _full.reserve(_np);
+    iota(_all.begin(), _all.end(), 0);
+    const size_t min_valid_num = _conf.min_valid_num;
     vector<bool> valid(_np, false);
     size_t num_valid = 0;
     do
     {
-#pragma omp parallel for reduction(+ : num_valid)
-		// OpenMP 2.0 doesn't allow unsigned for-loop index
-        for (int i = 0; i < (int)_np; ++i)
+        // sample serially, so that the initial population doesn't depend on thread scheduling
+        vector<size_t> todo;
+        for (size_t i = 0; i < _np; ++i)
         {
             if (!valid[i])
             {
-#pragma omp critical
+                todo.push_back(i);
+                if (i < _initial.size())
                 {
-                    for (size_t j = 0; j < _dim; ++j)
-                    {
-                        double lb = _ranges.at(j).first;
-                        double ub = _ranges.at(j).second;
-                        uniform_real_distribution<double> distr(lb, ub);
-                        _population[i][j] = distr(engine);
-                    }
+                    copy(_initial[i].begin(), _initial[i].end(), _population[i].begin());
+                    continue;
                 }
-                _results[i] = _func(i, _population[i]);
-                vector<double> vio_vec = _results[i].second;
-                auto inf_pred = [](const double x) -> bool
+                for (size_t j = 0; j < _dim; ++j)
                 {
-                    return std::isinf(x);
-                };
-                bool valid_flag = find_if(vio_vec.begin(), vio_vec.end(),
-                                          inf_pred) == vio_vec.end();
-                valid[i] = valid_flag;
-                num_valid += valid_flag ? 1 : 0;
+                    double lb = _ranges.at(j).first;
+                    double ub = _ranges.at(j).second;
+                    uniform_real_distribution<double> distr(lb, ub);
+                    _population[i][j] = distr(engine);
+                }
             }
         }
-        cout << "num_valid: " << num_valid
-             << ", min_valid_num: " << min_valid_num << endl;
+        evaluate(_population, _results, todo);
+        _initial.clear(); // invalid initial rows are sampled again
+        auto inf_pred = [](const double x) -> bool
+        {
+            return std::isinf(x);
+        };
+        for (size_t i : todo)
+        {
+            const vector<double>& vio_vec = _results[i].second;
+            bool valid_flag = find_if(vio_vec.begin(), vio_vec.end(),
+                                      inf_pred) == vio_vec.end();
+            valid[i] = valid_flag;
+            num_valid += valid_flag ? 1 : 0;
+        }
+        if (_log != nullptr)
+            *_log << "num_valid: " << num_valid
+                  << ", min_valid_num: " << min_valid_num << endl;
     } while (num_valid < min_valid_num);
+    for (size_t i = 0; _surrogate && i < _np; ++i)
+        _surrogate->add(*this, _population[i], _results[i]);
+    if (_crossover)
+        _crossover->population_changed(*this, nullptr, _population);
+}
+void DE::evaluate(const vector<Solution>& xs, vector<Evaluated>& results)
+{
+    assert(xs.size() == results.size());
+    if (_cache)
+    {
+        vector<size_t> which(xs.size());
+        iota(which.begin(), which.end(), 0);
+        evaluate(xs, results, which);
+        return;
+    }
+    if (_batch_func)
+        _scheduler.run_batch(xs.size(), [&]() { _batch_func(xs, results); });
+    else
+        _scheduler.run(xs.size(), [&](size_t i) { results[i] = _func(i, xs[i]); });
+}
+void DE::evaluate(const vector<Solution>& xs, vector<Evaluated>& results, const vector<size_t>& which)
+{
+    assert(xs.size() == results.size());
+    if (_cache)
+    {
+        // only the misses are evaluated, and stored in one append
+        const vector<size_t> misses = _cache->lookup(xs, results, which);
+        _evaluate(xs, results, misses);
+        _cache->insert(xs, results, misses);
+        return;
+    }
+    _evaluate(xs, results, which);
+}
+void DE::_evaluate(const vector<Solution>& xs, vector<Evaluated>& results, const vector<size_t>& which)
+{
+    if (_batch_func)
+    {
+        vector<Solution> batch;
+        batch.reserve(which.size());
+        for (size_t i : which)
+            batch.push_back(xs[i]);
+        vector<Evaluated> batch_results(batch.size());
+        _scheduler.run_batch(batch.size(), [&]() { _batch_func(batch, batch_results); });
+        for (size_t k = 0; k < which.size(); ++k)
+            results[which[k]] = move(batch_results[k]);
+        return;
+    }
+    auto eval = [&](size_t k) {
+        const size_t i = which[k];
+        results[i]     = _func(i, xs[i]);
+    };
+    // one captured reference fits the small buffer of std::function, dispatching allocates nothing
+    _scheduler.run(which, [&eval](size_t k) { eval(k); });
+}
+Evaluated DE::objective(size_t i, const Solution& x)
+{
+    Evaluated r;
+    if (_cache && _cache->find(x, r))
+        return r;
+    r = _func(i, x);
+    if (_cache)
+        _cache->insert(x, r);
+    return r;
+}
+void DE::evaluate(const vector<SparseTrial>& trials, vector<Evaluated>& results)
+{
+    assert(trials.size() == results.size());
+    if (_incremental_func)
+    {
+        _scheduler.run(trials.size(), [&](size_t i) {
+            const size_t t = trials[i].target;
+            results[i]     = _incremental_func(i, _population[t], _results[t], trials[i]);
+        });
+        return;
+    }
+    if (_batch_func || _cache)
+    {
+        // materialized into the trial rows of the arena: one call of the batch objective, one
+        // cache lookup and one append for the generation
+        assert(trials.size() == _trials.size());
+        for (size_t i = 0; i < trials.size(); ++i)
+        {
+            const Solution& target = _population[trials[i].target];
+            _trials[i].assign(target.begin(), target.end());
+            trials[i].apply(_trials[i]);
+        }
+        evaluate(_trials, results);
+        return;
+    }
+    auto eval = [&](size_t i) {
+        thread_local Solution x;
+        x = _population[trials[i].target];
+        trials[i].apply(x);
+        results[i] = _func(i, x);
+    };
+    _scheduler.run(trials.size(), [&eval](size_t i) { eval(i); });
+}
+void DE::evaluate_trials(vector<Solution>& trials, vector<Evaluated>& results, const vector<size_t>& which)
+{
+    assert(_kept.size() == _np);
+    fill(_kept.begin(), _kept.end(), 0);
+    if (_low_func && !_batch_func)
+    {
+        // low fidelity runs on a scheduler of its own, so that its latencies don't mix with the high
+        // fidelity ones in the statistics and the longest-first predictions
+        vector<size_t> misses;
+        if (_cache)
+            misses = _cache->lookup(trials, results, which, low_objective);
+        const vector<size_t>& low = _cache ? misses : which;
+        _low_scheduler.run(low, [&](size_t k) { results[low[k]] = _low_func(low[k], trials[low[k]]); });
+        if (_cache)
+            _cache->insert(trials, results, low, low_objective);
+        _full = promote(results, which);
+        for (size_t i : _full)
+            _kept[i] = 1;
+        for (size_t i : which)
+        {
+            if (!_kept[i])
+            {
+                // selection between a target and itself keeps the target
+                trials[i]  = _population[i];
+                results[i] = _results[i];
+            }
+        }
+        _fidelity_trials += which.size();
+        _fidelity_promoted += _full.size();
+    }
+    else
+    {
+        _full.assign(which.begin(), which.end());
+        for (size_t i : which)
+            _kept[i] = 1;
+    }
+    const vector<size_t>* todo = &_full;
+    if (!_staged_fom || _batch_func)
+    {
+        evaluate(trials, results, *todo);
+        return;
+    }
+    vector<size_t> misses;
+    if (_cache)
+    {
+        misses = _cache->lookup(trials, results, *todo);
+        todo   = &misses;
+    }
+    // the constraints are cheap, a static split is good enough
+    vector<ConstraintViolation> violations(todo->size());
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < static_cast<int>(todo->size()); ++k)
+        violations[k] = _staged_constraints((*todo)[k], trials[(*todo)[k]]);
+    vector<size_t> promising;
+    for (size_t k = 0; k < todo->size(); ++k)
+    {
+        const size_t i = (*todo)[k];
+        if (_selector->can_win(*this, violations[k], _results[i]))
+            promising.push_back(i);
+        results[i] = Evaluated(numeric_limits<double>::infinity(), move(violations[k]));
+    }
+    _scheduler.run(promising, [&](size_t k) {
+        const size_t i   = promising[k];
+        results[i].first = _staged_fom(i, trials[i]);
+    });
+    if (_cache)
+        _cache->insert(trials, results, promising); // the skipped ones aren't complete
+    _staged_stats.trials += todo->size();
+    _staged_stats.skipped += todo->size() - promising.size();
+}
+vector<size_t> DE::promote(const vector<Evaluated>& low_results, const vector<size_t>& which)
+{
+    vector<char> keep(which.size(), 0);
+    if (_fidelity.promotion != PromoteTop)
+    {
+        for (size_t k = 0; k < which.size(); ++k)
+        {
+            const size_t i = which[k];
+            if (_fidelity.margin == 0)
+                keep[k] = _selector->better(low_results[i], _results[i]);
+            else
+            {
+                Evaluated slack = low_results[i];
+                slack.first -= _fidelity.margin * fabs(_results[i].first);
+                keep[k] = _selector->better(slack, _results[i]);
+            }
+        }
+    }
+    if (_fidelity.promotion != PromoteWinners)
+    {
+        const size_t n = min(which.size(), static_cast<size_t>(ceil(_fidelity.top_fraction * which.size())));
+        vector<size_t> order(which.size());
+        iota(order.begin(), order.end(), 0);
+        partial_sort(order.begin(), order.begin() + n, order.end(), [&](size_t a, size_t b) {
+            const Evaluated& ra = low_results[which[a]];
+            const Evaluated& rb = low_results[which[b]];
+            return _selector->better(ra, rb) && !_selector->better(rb, ra);
+        });
+        for (size_t k = 0; k < n; ++k)
+            keep[order[k]] = 1;
+    }
+    vector<size_t> promoted;
+    for (size_t k = 0; k < which.size(); ++k)
+        if (keep[k])
+            promoted.push_back(which[k]);
+    return promoted;
+}
+void DE::set_multi_fidelity_objective(Objective low, Objective high)
+{
+    // every call is counted and timed at its fidelity, wherever it comes from
+    auto costed = [this](Objective f, Fidelity level) -> Objective {
+        return [this, f, level](const size_t i, const Solution& x) -> Evaluated {
+            const auto t0   = chrono::steady_clock::now();
+            Evaluated r     = f(i, x);
+            const auto dt   = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0);
+            _fidelity_evals[level].fetch_add(1, memory_order_relaxed);
+            _fidelity_ns[level].fetch_add(static_cast<uint64_t>(dt.count()), memory_order_relaxed);
+            return r;
+        };
+    };
+    _low_func = costed(low, LowFidelity);
+    _func     = costed(high, HighFidelity);
+}
+void DE::set_promotion_policy(const FidelityConfig& fidelity)
+{
+    DEConfig conf = _conf;
+    conf.fidelity = fidelity;
+    conf.validate();
+    _fidelity = fidelity;
+}
+FidelityStats DE::fidelity_stats() const noexcept
+{
+    FidelityStats stats;
+    stats.trials   = _fidelity_trials;
+    stats.promoted = _fidelity_promoted;
+    for (size_t l = 0; l < NumFidelities; ++l)
+    {
+        stats.evaluations[l] = _fidelity_evals[l].load();
+        stats.seconds[l]     = 1e-9 * static_cast<double>(_fidelity_ns[l].load());
+    }
+    return stats;
+}
+void FidelityStats::report(ostream& os) const
+{
+    const double total = seconds[LowFidelity] + seconds[HighFidelity];
+    os << "Multi-fidelity: trials: " << trials << ", promoted to high fidelity: " << promoted << " ("
+       << (trials == 0 ? 0 : 100.0 * static_cast<double>(promoted) / static_cast<double>(trials)) << "%)" << endl;
+    const char* names[NumFidelities] = {"low", "high"};
+    for (size_t l = 0; l < NumFidelities; ++l)
+    {
+        os << "  " << names[l] << " fidelity: evaluations: " << evaluations[l] << ", seconds: " << seconds[l]
+           << " (" << (total == 0 ? 0 : 100.0 * seconds[l] / total) << "% of the evaluation time)";
+        if (evaluations[l] != 0)
+            os << ", seconds per evaluation: " << seconds[l] / static_cast<double>(evaluations[l]);
+        os << endl;
+    }
+}
+void DE::set_staged_objective(ConstraintFunction constraints, FomFunction fom)
+{
+    _staged_constraints = constraints;
+    _staged_fom         = fom;
+    _func               = [constraints, fom](const size_t i, const Solution& x) -> Evaluated {
+        ConstraintViolation vio = constraints(i, x);
+        return Evaluated(fom(i, x), vio);
+    };
+}
+void StagedStats::report(ostream& os) const
+{
+    os << "Staged evaluation: trials: " << trials << ", figure of merit skipped: " << skipped << " ("
+       << (trials == 0 ? 0 : 100.0 * static_cast<double>(skipped) / static_cast<double>(trials)) << "%)"
+       << endl;
+}
+void DE::screened_evaluate(vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    assert(_surrogate && trials.size() == _np && trial_results.size() == _np);
+    const vector<size_t> to_evaluate = _surrogate->screen(*this, *_selector, trials, _results);
+    evaluate_trials(trials, trial_results, to_evaluate);
+    // the trials not promoted to high fidelity are copies of their targets, neither wins nor points
+    _surrogate->record(*_selector, _full, trial_results, _results);
+    for (size_t i : _full)
+        _surrogate->add(*this, trials[i], trial_results[i]);
+    for (size_t i = 0; i < _np; ++i)
+    {
+        if (!_kept[i])
+        {
+            // selection between a target and itself keeps the target
+            trials[i]        = _population[i];
+            trial_results[i] = _results[i];
+        }
+    }
+}
+bool DE::end_generation()
+{
+    if (_local_search)
+    {
+        PhaseTimer t(_metrics, PhaseLocalSearch);
+        local_search_step();
+    }
+    update_metrics();
+    report_best();
+    const bool go_on = !_on_generation || _on_generation(*this);
+    // the running job is finished rather than stopped, its budget is bounded and a seeded run
+    // stays reproducible
+    if (!go_on && _local_search && _local_search->running())
+        inject(_local_search->collect());
+    if (!go_on)
+    {
+        _stopped        = true;
+        _stopped_engine = engine; // `resume` may run on another thread
+    }
+    return go_on;
+}
+void DE::local_search_step()
+{
+    LocalSearch& ls     = *_local_search;
+    const size_t period = ls.config().period;
+    const bool last     = _curr_gen + 1 >= _max_iter;
+    if (ls.running() && (last || _curr_gen >= ls.launched_at() + period))
+        inject(ls.collect());
+    if (ls.running() || last || _curr_gen % period != 0)
+        return;
+    const size_t k         = min(ls.config().top_k, _np);
+    const size_t per_point = ls.config().max_evals == 0 ? 50 * _dim : ls.config().max_evals;
+    const size_t budget    = min(per_point, ls.allowance(_scheduler.evaluations()) / k);
+    if (budget < _dim + 2)
+        return; // not even a simplex or a gradient
+    vector<size_t> order(_np);
+    iota(order.begin(), order.end(), 0);
+    partial_sort(order.begin(), order.begin() + k, order.end(), [&](size_t a, size_t b) {
+        return _selector->better(_results[a], _results[b]) && !_selector->better(_results[b], _results[a]);
+    });
+    order.resize(k);
+    ls.launch(*this, _curr_gen, order, budget,
+              [this](size_t i, const Solution& x) -> Evaluated { return objective(i, x); },
+              _scheduler);
+}
+void DE::inject(const vector<LocalSearch::Refined>& refined)
+{
+    size_t injected = 0;
+    for (const auto& r : refined)
+    {
+        size_t worst = 0;
+        for (size_t i = 1; i < _np; ++i)
+            if (!_selector->better(_results[i], _results[worst]))
+                worst = i;
+        if (!_selector->better(r.result, _results[worst]) || _selector->better(_results[worst], r.result))
+            continue;
+        copy(r.x.begin(), r.x.end(), _population[worst].begin());
+        _results[worst] = r.result;
+        if (_surrogate)
+            _surrogate->add(*this, _population[worst], _results[worst]);
+        ++injected;
+    }
+    if (injected > 0 && _crossover)
+        _crossover->population_changed(*this, nullptr, _population);
+    _local_search->add_injected(injected);
+}
+void DE::repair(vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    if (!_repair)
+        return;
+    auto evaluate_points = [this](const vector<Solution>& xs, const vector<size_t>& owners,
+                                  vector<Evaluated>& results) { _evaluate_points(xs, owners, results); };
+    auto probe_points = [&](const vector<Solution>& xs, const vector<size_t>& owners, vector<Evaluated>& results) {
+        if (!_staged_constraints || _batch_func)
+        {
+            evaluate_points(xs, owners, results);
+            return;
+        }
+        // the jacobian only needs the constraints, which are cheap
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < static_cast<int>(xs.size()); ++k)
+            results[k] = Evaluated(numeric_limits<double>::infinity(), _staged_constraints(owners[k], xs[k]));
+    };
+    _repair->repair(*this, probe_points, evaluate_points, trials, trial_results);
+}
+void DE::_evaluate_points(const vector<Solution>& xs, const vector<size_t>& owners, vector<Evaluated>& results)
+{
+    assert(xs.size() == owners.size() && xs.size() == results.size());
+    vector<size_t> all(xs.size());
+    iota(all.begin(), all.end(), 0);
+    const vector<size_t> misses = _cache ? _cache->lookup(xs, results, all) : all;
+    if (_batch_func)
+    {
+        vector<Solution> batch;
+        batch.reserve(misses.size());
+        for (size_t k : misses)
+            batch.push_back(xs[k]);
+        vector<Evaluated> batch_results(batch.size());
+        _scheduler.run_batch(batch.size(), [&]() { _batch_func(batch, batch_results); });
+        for (size_t k = 0; k < misses.size(); ++k)
+            results[misses[k]] = move(batch_results[k]);
+    }
+    else
+    {
+        // outside the scheduler, several points per owner would overwrite its longest-first prediction
+#pragma omp parallel for schedule(dynamic)
+        for (int k = 0; k < static_cast<int>(misses.size()); ++k)
+            results[misses[k]] = _func(owners[misses[k]], xs[misses[k]]);
+        _scheduler.count(misses.size());
+    }
+    if (_cache)
+        _cache->insert(xs, results, misses);
+}
+void DE::enable_gradient_repair(double prob, size_t max_steps, double fd_step)
+{
+    _repair.reset(new GradientRepair(prob, max_steps, fd_step));
+}
+void DE::enable_surrogate(size_t k, double explore, size_t min_archive, size_t max_archive)
+{
+    if (k == 0)
+        throw ConfigError("surrogate_k should be positive");
+    _surrogate.reset(new SurrogateScreen(new Surrogate_KNN(k), explore,
+                                         min_archive == 0 ? 2 * _np : min_archive,
+                                         max_archive == 0 ? 20 * _np : max_archive));
+}
+void DE::reinitialize(size_t np, size_t max_iter)
+{
+    if (np < 4)
+        throw ConfigError("np should be at least 4");
+    if (np < _conf.min_valid_num)
+        throw ConfigError("min_valid_num should not exceed np");
+    if (max_iter < 1)
+        throw ConfigError("max_iter should be positive");
+    _np       = np;
+    _max_iter = max_iter;
+    _curr_gen = 0;
+}
+void DE::set_initial_population(const vector<Solution>& xs)
+{
+    for (const auto& x : xs)
+        if (x.size() != _dim)
+            throw ConfigError("Initial solution of dimension " + to_string(x.size()) + ", expected " +
+                              to_string(_dim));
+    _initial.assign(xs.begin(), xs.begin() + min(xs.size(), _np));
+}
+void DE::enable_eval_cache(const string& path, const string& tag, double resolution)
+{
+    _cache.reset(new EvalCache(path, tag, _ranges, resolution));
+}
+void DE::enable_local_search(const LocalSearchConfig& conf)
+{
+    _local_search.reset(new LocalSearch(conf));
+}
+void DE::enable_numa(size_t num_threads)
+{
+    _numa.reset(new NumaTeam(num_threads));
+    _scheduler.set_team(_numa.get());
+    _scheduler.set_policy(NumaOwner);
+    _low_scheduler.set_team(_numa.get());
+    _low_scheduler.set_policy(NumaOwner);
+}
+void DE::set_schedule_policy(SchedulePolicy p, size_t chunk) noexcept
+{
+    _scheduler.set_policy(p);
+    _scheduler.set_chunk(chunk);
+    _low_scheduler.set_policy(p);
+    _low_scheduler.set_chunk(chunk);
 }
 size_t DE::find_best() const noexcept
 {
@@ -229,17 +871,32 @@ size_t DE::find_best() const noexcept
                     });
     return distance(_results.begin(), min_iter);
 }
+void DE::update_metrics() noexcept
+{
+    const Evaluated& best = _results[find_best()];
+    _metrics.set_generation(_curr_gen);
+    _metrics.set_best(best.first, accumulate(best.second.begin(), best.second.end(), 0.0));
+    auto epsilon = dynamic_cast<const Selector_Epsilon*>(_selector);
+    if (epsilon != nullptr)
+        _metrics.set_epsilon(epsilon->level());
+}
+size_t DE::slots() const noexcept
+{
+    return _np + (_local_search ? min(_local_search->config().top_k, _np) : 0);
+}
 void DE::report_best() const noexcept
 {
+    if (_log == nullptr)
+        return;
     size_t best_idx = find_best();
     const Evaluated& best_result = _results[best_idx];
     const double violation = accumulate(best_result.second.begin(), best_result.second.end(), 0.0);
     double total_violation = 0;
-    for(auto r : _results)
+    for(const auto& r : _results)
     {
         total_violation += accumulate(r.second.begin(), r.second.end(), 0.0);
     }
-    cout << "Best idx: " << best_idx << ", Best FOM: " << best_result.first
+    *_log << "Best idx: " << best_idx << ", Best FOM: " << best_result.first
          << ", Constraint Violation: " << violation 
          << ", Average Constraint Violation: " << total_violation / _results.size() << endl;
 }
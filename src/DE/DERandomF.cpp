@@ -4,11 +4,9 @@
 using namespace std;
 double DERandomF::f() const noexcept
 {
-    auto fsigma_iter = _extra_conf.find("fsigma");
-    double fsigma = 0;
-    if(fsigma_iter != _extra_conf.end())
-    {
-        fsigma = fsigma_iter->second;
-    }
-    return normal_distribution<double>(_f, fsigma)(engine);
+    // one distribution per thread, the mutations of the NUMA mode draw concurrently; reset so that
+    // no cached value crosses from one call (or one seeded run) to the next
+    thread_local normal_distribution<double> distr;
+    distr.reset();
+    return distr(engine, _f_param);
 }
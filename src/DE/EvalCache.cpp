@@ -0,0 +1,356 @@
+#include "DE/EvalCache.h"
+#include "DE/DEConfig.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+#define DE_EVAL_CACHE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+using namespace std;
+namespace
+{
+const char magic[8]          = {'D', 'E', 'E', 'V', 'A', 'L', '0', '1'};
+const size_t file_header_size = 32;
+// followed by the quantized coordinates (int64), the figure of merit and the constraint violations
+// (double), every record is 8-byte aligned
+struct RecordHeader
+{
+    uint32_t size;     // of the whole record
+    uint32_t checksum; // of the record from `key` on
+    uint64_t key;
+    uint64_t scope;
+    uint32_t dim;
+    uint32_t num_constraints;
+};
+static_assert(sizeof(RecordHeader) == 32, "unexpected record header padding");
+const size_t checked_from = offsetof(RecordHeader, key);
+
+uint64_t fnv1a(const void* data, size_t n, uint64_t h = 14695981039346656037ULL)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+uint32_t checksum(const char* record, size_t size)
+{
+    const uint64_t h = fnv1a(record + checked_from, size - checked_from);
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+size_t record_size(size_t dim, size_t num_constraints)
+{
+    return sizeof(RecordHeader) + sizeof(int64_t) * dim + sizeof(double) * (1 + num_constraints);
+}
+void append_record(string& buf, uint64_t key, uint64_t scope, const vector<int64_t>& q, const Evaluated& r)
+{
+    RecordHeader h;
+    h.size            = static_cast<uint32_t>(record_size(q.size(), r.second.size()));
+    h.checksum        = 0;
+    h.key             = key;
+    h.scope           = scope;
+    h.dim             = static_cast<uint32_t>(q.size());
+    h.num_constraints = static_cast<uint32_t>(r.second.size());
+    const size_t at   = buf.size();
+    buf.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    buf.append(reinterpret_cast<const char*>(q.data()), sizeof(int64_t) * q.size());
+    buf.append(reinterpret_cast<const char*>(&r.first), sizeof(double));
+    buf.append(reinterpret_cast<const char*>(r.second.data()), sizeof(double) * r.second.size());
+    h.checksum = checksum(&buf[at], h.size);
+    memcpy(&buf[at] + offsetof(RecordHeader, checksum), &h.checksum, sizeof(h.checksum));
+}
+}
+uint64_t EvalCache::_scope(unsigned objective) const noexcept
+{
+    return fnv1a(&objective, sizeof(objective), _base);
+}
+uint64_t EvalCache::_key(const Solution& x, uint64_t scope, vector<int64_t>& q) const
+{
+    q.resize(x.size());
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+        const double lb   = _ranges[j].first;
+        const double step = (_ranges[j].second - lb) * _resolution;
+        const double v    = x[j];
+        if (!std::isfinite(v))
+            q[j] = numeric_limits<int64_t>::min();
+        else if (step <= 0)
+            q[j] = 0;
+        else
+            q[j] = llround(max(-9e18, min(9e18, (v - lb) / step)));
+    }
+    return fnv1a(q.data(), sizeof(int64_t) * q.size(), scope);
+}
+bool EvalCache::_get(uint64_t key, uint64_t scope, const vector<int64_t>& q, Evaluated& out) const
+{
+    auto range = _index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const char* rec = _map + it->second;
+        RecordHeader h;
+        memcpy(&h, rec, sizeof(h));
+        if (h.scope != scope || h.dim != q.size() ||
+            memcmp(rec + sizeof(h), q.data(), sizeof(int64_t) * q.size()) != 0)
+            continue; // hash collision
+        const char* values = rec + sizeof(h) + sizeof(int64_t) * q.size();
+        memcpy(&out.first, values, sizeof(double));
+        out.second.resize(h.num_constraints);
+        memcpy(out.second.data(), values + sizeof(double), sizeof(double) * h.num_constraints);
+        return true;
+    }
+    return false;
+}
+void EvalCache::_scan(size_t size)
+{
+    // stop at the first incomplete or corrupted record, the tail of a crashed writer
+    while (_scanned + sizeof(RecordHeader) <= size)
+    {
+        RecordHeader h;
+        memcpy(&h, _map + _scanned, sizeof(h));
+        if (h.size != record_size(h.dim, h.num_constraints) || _scanned + h.size > size ||
+            h.checksum != checksum(_map + _scanned, h.size))
+            break;
+        _index.emplace(h.key, _scanned);
+        _scanned += h.size;
+    }
+}
+vector<size_t> EvalCache::lookup(const vector<Solution>& xs, vector<Evaluated>& results, const vector<size_t>& which,
+                                 unsigned objective)
+{
+    thread_local vector<int64_t> q;
+    const uint64_t scope = _scope(objective);
+    vector<size_t> misses;
+    lock_guard<mutex> lk(_m);
+    for (size_t i : which)
+        if (!_get(_key(xs[i], scope, q), scope, q, results[i]))
+            misses.push_back(i);
+    if (!misses.empty())
+    {
+        _refresh();
+        // other processes may have evaluated some of them meanwhile
+        vector<size_t> still;
+        for (size_t i : misses)
+            if (!_get(_key(xs[i], scope, q), scope, q, results[i]))
+                still.push_back(i);
+        misses.swap(still);
+    }
+    _lookups.fetch_add(which.size());
+    _hits.fetch_add(which.size() - misses.size());
+    return misses;
+}
+bool EvalCache::find(const Solution& x, Evaluated& result, unsigned objective)
+{
+    thread_local vector<int64_t> q;
+    const uint64_t scope = _scope(objective);
+    const uint64_t key   = _key(x, scope, q);
+    lock_guard<mutex> lk(_m);
+    bool hit = _get(key, scope, q, result);
+    if (!hit)
+    {
+        _refresh();
+        hit = _get(key, scope, q, result);
+    }
+    _lookups.fetch_add(1);
+    _hits.fetch_add(hit ? 1 : 0);
+    return hit;
+}
+void EvalCache::insert(const Solution& x, const Evaluated& result, unsigned objective)
+{
+    const vector<Solution> xs(1, x);
+    const vector<Evaluated> results(1, result);
+    insert(xs, results, vector<size_t>(1, 0), objective);
+}
+double EvalCache::hit_rate() const noexcept
+{
+    const size_t n = lookups();
+    return n == 0 ? 0 : static_cast<double>(hits()) / static_cast<double>(n);
+}
+size_t EvalCache::records() const
+{
+    lock_guard<mutex> lk(_m);
+    return _index.size();
+}
+void EvalCache::report(ostream& os) const
+{
+    os << "Evaluation cache " << _path << ": lookups: " << lookups() << ", hits: " << hits() << " ("
+       << 100.0 * hit_rate() << "%), inserted: " << inserted() << ", records: " << records() << endl;
+}
+#ifdef DE_EVAL_CACHE_MMAP
+namespace
+{
+// flock for the lifetime of the object
+class FileLock
+{
+public:
+    FileLock(int fd, int op) : _fd(fd)
+    {
+        while (flock(_fd, op) != 0)
+            if (errno != EINTR)
+                throw runtime_error(string("flock: ") + strerror(errno));
+    }
+    ~FileLock() { flock(_fd, LOCK_UN); }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    const int _fd;
+};
+bool truncate_to(int fd, size_t size)
+{
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+size_t file_size(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw runtime_error(string("fstat: ") + strerror(errno));
+    return static_cast<size_t>(st.st_size);
+}
+}
+EvalCache::EvalCache(const string& path, const string& tag, const Ranges& ranges, double resolution)
+    : _path(path), _ranges(ranges), _resolution(resolution), _fd(-1), _map(nullptr), _mapped(0),
+      _scanned(file_header_size)
+{
+    if (!(resolution > 0 && resolution < 1))
+        throw ConfigError("The cache resolution should be in (0, 1)");
+    _lookups.store(0);
+    _hits.store(0);
+    _inserted.store(0);
+    const uint64_t dim = ranges.size();
+    _base              = fnv1a(tag.data(), tag.size());
+    _base              = fnv1a(&dim, sizeof(dim), _base);
+    for (const auto& rg : ranges)
+        _base = fnv1a(&rg, sizeof(rg), _base);
+    _base = fnv1a(&_resolution, sizeof(_resolution), _base);
+
+    _fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_fd < 0)
+        throw runtime_error("Cannot open the evaluation cache " + path + ": " + strerror(errno));
+    try
+    {
+        FileLock lock(_fd, LOCK_EX);
+        char header[file_header_size];
+        const size_t size = file_size(_fd);
+        if (size == 0)
+        {
+            memset(header, 0, sizeof(header));
+            memcpy(header, magic, sizeof(magic));
+            if (pwrite(_fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+                throw runtime_error("Cannot write the evaluation cache " + path + ": " + strerror(errno));
+        }
+        else if (size < file_header_size || pread(_fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+                 memcmp(header, magic, sizeof(magic)) != 0)
+            throw runtime_error(path + " is not an evaluation cache");
+        const size_t n = max(size, file_header_size);
+        _remap(n);
+        _scan(n);
+    }
+    catch (...)
+    {
+        if (_map != nullptr)
+            munmap(const_cast<char*>(_map), _mapped);
+        close(_fd);
+        throw;
+    }
+}
+EvalCache::~EvalCache()
+{
+    if (_map != nullptr)
+        munmap(const_cast<char*>(_map), _mapped);
+    close(_fd);
+}
+void EvalCache::_remap(size_t size)
+{
+    if (size == _mapped)
+        return;
+    void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (m == MAP_FAILED)
+        throw runtime_error("Cannot map the evaluation cache " + _path + ": " + strerror(errno));
+    if (_map != nullptr)
+        munmap(const_cast<char*>(_map), _mapped);
+    _map    = static_cast<const char*>(m);
+    _mapped = size;
+}
+void EvalCache::_refresh()
+{
+    if (file_size(_fd) == _mapped)
+        return;
+    // appends hold the exclusive lock, so the records seen under the shared one are complete
+    FileLock lock(_fd, LOCK_SH);
+    const size_t size = file_size(_fd);
+    _remap(size);
+    _scan(size);
+}
+void EvalCache::insert(const vector<Solution>& xs, const vector<Evaluated>& results, const vector<size_t>& which,
+                       unsigned objective)
+{
+    thread_local vector<int64_t> q;
+    const uint64_t scope = _scope(objective);
+    Evaluated stored;
+    string buf;
+    size_t n = 0;
+    lock_guard<mutex> lk(_m);
+    FileLock lock(_fd, LOCK_EX);
+    const size_t size = file_size(_fd);
+    _remap(size);
+    _scan(size);
+    for (size_t i : which)
+    {
+        const uint64_t key = _key(xs[i], scope, q);
+        if (_get(key, scope, q, stored))
+            continue; // evaluated by another run meanwhile
+        append_record(buf, key, scope, q, results[i]);
+        ++n;
+    }
+    if (buf.empty())
+        return;
+    // the records are written over the tail of a crashed writer, if any
+    if (_scanned < size && !truncate_to(_fd, _scanned))
+        throw runtime_error("Cannot truncate the evaluation cache " + _path + ": " + strerror(errno));
+    for (size_t done = 0; done < buf.size();)
+    {
+        const ssize_t w = pwrite(_fd, buf.data() + done, buf.size() - done, static_cast<off_t>(_scanned + done));
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+        {
+            const string err = strerror(errno);
+            truncate_to(_fd, _scanned);
+            throw runtime_error("Cannot write the evaluation cache " + _path + ": " + err);
+        }
+        done += static_cast<size_t>(w);
+    }
+    _remap(_scanned + buf.size());
+    _scan(_scanned + buf.size());
+    _inserted.fetch_add(n);
+}
+#else
+EvalCache::EvalCache(const string& path, const string&, const Ranges& ranges, double resolution)
+    : _path(path), _ranges(ranges), _resolution(resolution), _base(0), _fd(-1), _map(nullptr), _mapped(0),
+      _scanned(0)
+{
+    throw runtime_error("The evaluation cache requires POSIX file mapping");
+}
+EvalCache::~EvalCache()
+{
+}
+void EvalCache::_remap(size_t)
+{
+}
+void EvalCache::_refresh()
+{
+}
+void EvalCache::insert(const vector<Solution>&, const vector<Evaluated>&, const vector<size_t>&, unsigned)
+{
+}
+#endif
@@ -0,0 +1,349 @@
+#include "DE/EvalScheduler.h"
+#include "DE/DEConfig.h"
+#include "DE/Numa.h"
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <omp.h>
+using namespace std;
+namespace
+{
+size_t pool_default_size = 0;
+double elapsed_since(const chrono::steady_clock::time_point& t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+}
+void LatencyHistogram::record(double seconds) noexcept
+{
+    const uint64_t ns = seconds <= 0 ? 0 : static_cast<uint64_t>(seconds * 1e9);
+    const double us   = static_cast<double>(ns) * 1e-3;
+    size_t k          = us < 1 ? 0 : static_cast<size_t>(log2(us));
+    k                 = min(k, num_buckets - 1);
+    _buckets[k].fetch_add(1, memory_order_relaxed);
+    _count.fetch_add(1, memory_order_relaxed);
+    _sum_ns.fetch_add(ns, memory_order_relaxed);
+    uint64_t prev_max = _max_ns.load(memory_order_relaxed);
+    while (prev_max < ns && !_max_ns.compare_exchange_weak(prev_max, ns, memory_order_relaxed));
+}
+void LatencyHistogram::clear() noexcept
+{
+    for (size_t k = 0; k < num_buckets; ++k)
+        _buckets[k].store(0);
+    _count.store(0);
+    _sum_ns.store(0);
+    _max_ns.store(0);
+}
+double LatencyHistogram::mean() const noexcept
+{
+    const uint64_t n = _count.load();
+    return n == 0 ? 0 : 1e-9 * static_cast<double>(_sum_ns.load()) / static_cast<double>(n);
+}
+double LatencyHistogram::quantile(double q) const noexcept
+{
+    const uint64_t n = _count.load();
+    if (n == 0)
+        return 0;
+    const double target = q * static_cast<double>(n);
+    uint64_t acc = 0;
+    for (size_t k = 0; k < num_buckets; ++k)
+    {
+        acc += _buckets[k].load();
+        if (static_cast<double>(acc) >= target)
+            return 1e-6 * pow(2.0, static_cast<double>(k + 1));
+    }
+    return max();
+}
+void LatencyHistogram::print(ostream& os) const
+{
+    os << "count: " << count() << ", mean: " << mean() << "s, p50 <= " << quantile(0.5)
+       << "s, p90 <= " << quantile(0.9) << "s, p99 <= " << quantile(0.99) << "s, max: " << max()
+       << "s" << endl;
+    for (size_t k = 0; k < num_buckets; ++k)
+    {
+        const uint64_t c = bucket(k);
+        if (c > 0)
+            os << "    [" << (k == 0 ? 0 : pow(2.0, (double)k)) << "us, " << pow(2.0, (double)k + 1)
+               << "us): " << c << endl;
+    }
+}
+
+ThreadPool::ThreadPool(size_t num_threads) : _pending(0), _stop(false)
+{
+    num_threads = max<size_t>(1, num_threads);
+    for (size_t i = 0; i < num_threads; ++i)
+        _workers.emplace_back(new Worker);
+    for (size_t i = 0; i < num_threads; ++i)
+        _threads.emplace_back(&ThreadPool::_work, this, i);
+}
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lk(_sleep_m);
+        _stop = true;
+    }
+    _sleep_cv.notify_all();
+    for (auto& t : _threads)
+        t.join();
+}
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool(pool_default_size > 0 ? pool_default_size : static_cast<size_t>(omp_get_max_threads()));
+    return pool;
+}
+void ThreadPool::set_default_size(size_t num_threads)
+{
+    pool_default_size = num_threads;
+}
+void ThreadPool::run(size_t n, const Task& task)
+{
+    _run(n, nullptr, task);
+}
+void ThreadPool::run(const vector<size_t>& order, const Task& task)
+{
+    _run(order.size(), order.data(), task);
+}
+void ThreadPool::_run(size_t n, const size_t* order, const Task& task)
+{
+    if (n == 0)
+        return;
+    Batch batch;
+    batch.task = &task;
+    batch.remaining.store(n);
+    // deal tasks round-robin, so that every worker starts with the most expensive ones
+    for (size_t w = 0; w < _workers.size() && w < n; ++w)
+    {
+        lock_guard<mutex> lk(_workers[w]->m);
+        for (size_t k = w; k < n; k += _workers.size())
+            _workers[w]->queue.push_back(Item{&batch, order == nullptr ? k : order[k]});
+    }
+    {
+        lock_guard<mutex> lk(_sleep_m);
+        _pending.fetch_add(n);
+    }
+    _sleep_cv.notify_all();
+
+    Item item;
+    while (batch.remaining.load() > 0)
+    {
+        if (_take_from(&batch, item))
+        {
+            _execute(item);
+            continue;
+        }
+        // all remaining tasks of this batch are running on other threads
+        unique_lock<mutex> lk(batch.m);
+        batch.done.wait(lk, [&]() { return batch.remaining.load() == 0; });
+    }
+    lock_guard<mutex> lk(batch.m); // the last worker may still hold the lock
+    if (batch.error)
+        rethrow_exception(batch.error);
+}
+void ThreadPool::_work(size_t id)
+{
+    Item item;
+    while (true)
+    {
+        if (_take(id, item))
+        {
+            _execute(item);
+            continue;
+        }
+        unique_lock<mutex> lk(_sleep_m);
+        _sleep_cv.wait(lk, [&]() { return _stop || _pending.load() > 0; });
+        if (_stop && _pending.load() == 0)
+            return;
+    }
+}
+bool ThreadPool::_take(size_t id, Item& item)
+{
+    {
+        Worker& own = *_workers[id];
+        lock_guard<mutex> lk(own.m);
+        if (!own.queue.empty())
+        {
+            item = own.queue.front();
+            own.queue.pop_front();
+            _pending.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t k = 1; k < _workers.size(); ++k)
+    {
+        Worker& victim = *_workers[(id + k) % _workers.size()];
+        lock_guard<mutex> lk(victim.m);
+        if (!victim.queue.empty())
+        {
+            item = victim.queue.back();
+            victim.queue.pop_back();
+            _pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+bool ThreadPool::_take_from(const Batch* batch, Item& item)
+{
+    for (auto& w : _workers)
+    {
+        lock_guard<mutex> lk(w->m);
+        for (auto it = w->queue.rbegin(); it != w->queue.rend(); ++it)
+        {
+            if (it->batch == batch)
+            {
+                item = *it;
+                w->queue.erase(next(it).base());
+                _pending.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+void ThreadPool::_execute(const Item& item)
+{
+    Batch& batch = *item.batch;
+    exception_ptr error;
+    try
+    {
+        (*batch.task)(item.idx);
+    }
+    catch (...)
+    {
+        error = current_exception();
+    }
+    lock_guard<mutex> lk(batch.m);
+    if (error && !batch.error)
+        batch.error = error;
+    if (batch.remaining.fetch_sub(1) == 1)
+        batch.done.notify_all();
+}
+
+EvalScheduler::EvalScheduler(SchedulePolicy p, size_t chunk)
+    : _policy(p), _chunk(chunk == 0 ? 1 : chunk), _team(nullptr), _num_eval(0), _busy(0), _wall(0), _capacity(0)
+{
+}
+void EvalScheduler::run(size_t n, const function<void(size_t)>& eval)
+{
+    // 0 .. n - 1, only the new tail is filled when it grows
+    const size_t filled = min(_all.size(), n);
+    _all.resize(n);
+    iota(_all.begin() + filled, _all.end(), filled);
+    run(_all, eval);
+}
+void EvalScheduler::run(const vector<size_t>& which, const function<void(size_t)>& eval)
+{
+    const size_t n = which.size();
+    if (n == 0)
+        return;
+    const size_t needed = *max_element(which.begin(), which.end()) + 1;
+    if (_durations.size() < needed)
+        _durations.resize(needed, 0);
+    vector<double>& batch_durations = _batch_durations;
+    batch_durations.assign(n, 0);
+    auto timed_eval = [&](size_t k) {
+        const auto t0 = chrono::steady_clock::now();
+        eval(k);
+        const double dt      = elapsed_since(t0);
+        batch_durations[k]   = dt;
+        _durations[which[k]] = dt;
+        _latency.record(dt);
+    };
+    const int chunk = static_cast<int>(_chunk);
+    size_t threads  = static_cast<size_t>(omp_get_max_threads());
+    const auto t0   = chrono::steady_clock::now();
+    switch (_policy)
+    {
+        case OmpStatic:
+#pragma omp parallel for schedule(static)
+            // OpenMP 2.0 doesn't allow unsigned for loop index!
+            for (int k = 0; k < static_cast<int>(n); ++k)
+                timed_eval(k);
+            break;
+        case OmpDynamic:
+#pragma omp parallel for schedule(dynamic, chunk)
+            for (int k = 0; k < static_cast<int>(n); ++k)
+                timed_eval(k);
+            break;
+        case OmpGuided:
+#pragma omp parallel for schedule(guided, chunk)
+            for (int k = 0; k < static_cast<int>(n); ++k)
+                timed_eval(k);
+            break;
+        case WorkStealing:
+            threads = ThreadPool::instance().size() + 1; // the caller helps
+            ThreadPool::instance().run(n, timed_eval);
+            break;
+        case LongestFirst:
+        {
+            // positions in the batch, ordered by the last duration of their individuals
+            vector<size_t>& order = _order;
+            order.resize(n);
+            iota(order.begin(), order.end(), 0);
+            sort(order.begin(), order.end(), [&](size_t a, size_t b) -> bool {
+                const double da = _durations[which[a]], db = _durations[which[b]];
+                return da > db || (da == db && a < b); // stable, without the buffer of stable_sort
+            });
+            threads = ThreadPool::instance().size() + 1; // the caller helps
+            ThreadPool::instance().run(order, timed_eval);
+            break;
+        }
+        case NumaOwner:
+        {
+            if (_team == nullptr)
+                throw ConfigError("The numa-owner schedule requires NUMA mode");
+            // every individual on its owner thread, not every position of the batch
+            vector<size_t>& position = _position;
+            position.assign(needed, n);
+            for (size_t k = 0; k < n; ++k)
+                position[which[k]] = k;
+            threads = _team->size();
+            _team->run(needed, [&](size_t i) {
+                if (position[i] != n)
+                    timed_eval(position[i]);
+            });
+            break;
+        }
+        default:
+            throw ConfigError("Unrecognized Schedule Policy");
+    }
+    const double wall = elapsed_since(t0);
+    _wall += wall;
+    _capacity += wall * static_cast<double>(threads);
+    _busy += accumulate(batch_durations.begin(), batch_durations.end(), 0.0);
+    _num_eval.fetch_add(n);
+}
+void EvalScheduler::run_batch(size_t n, const function<void()>& eval)
+{
+    if (n == 0)
+        return;
+    const auto t0 = chrono::steady_clock::now();
+    eval();
+    const double wall = elapsed_since(t0);
+    for (size_t i = 0; i < n; ++i)
+        _latency.record(wall / static_cast<double>(n));
+    _wall += wall;
+    _capacity += wall;
+    _busy += wall;
+    _num_eval.fetch_add(n);
+}
+double EvalScheduler::efficiency() const noexcept
+{
+    return _capacity == 0 ? 0 : _busy / _capacity;
+}
+void EvalScheduler::clear_stats() noexcept
+{
+    _latency.clear();
+    _num_eval.store(0);
+    _busy     = 0;
+    _wall     = 0;
+    _capacity = 0;
+}
+void EvalScheduler::report(ostream& os) const
+{
+    os << "Evaluations: " << evaluations() << ", busy time: " << _busy << "s, wall time: " << _wall
+       << "s, parallel efficiency: " << efficiency() << endl
+       << "Evaluation latency: ";
+    _latency.print(os);
+}
@@ -0,0 +1,201 @@
+#include "DE/GradientRepair.h"
+#include "DE/DEOrigin.h"
+#include "global.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cassert>
+#include <cmath>
+#include <limits>
+using namespace std;
+namespace
+{
+double total_violation(const Evaluated& e)
+{
+    return accumulate(e.second.begin(), e.second.end(), 0.0);
+}
+// solve A * y = b in place by gaussian elimination with partial pivoting
+bool solve_linear(vector<vector<double>>& a, vector<double>& b)
+{
+    const size_t n = b.size();
+    for (size_t c = 0; c < n; ++c)
+    {
+        size_t pivot = c;
+        for (size_t r = c + 1; r < n; ++r)
+            if (fabs(a[r][c]) > fabs(a[pivot][c]))
+                pivot = r;
+        if (a[pivot][c] == 0)
+            return false;
+        swap(a[c], a[pivot]);
+        swap(b[c], b[pivot]);
+        for (size_t r = c + 1; r < n; ++r)
+        {
+            const double factor = a[r][c] / a[c][c];
+            for (size_t k = c; k < n; ++k)
+                a[r][k] -= factor * a[c][k];
+            b[r] -= factor * b[c];
+        }
+    }
+    for (size_t c = n; c-- > 0;)
+    {
+        for (size_t k = c + 1; k < n; ++k)
+            b[c] -= a[c][k] * b[k];
+        b[c] /= a[c][c];
+    }
+    return true;
+}
+}
+double RepairStats::evaluations_per_feasible() const noexcept
+{
+    return became_feasible == 0 ? numeric_limits<double>::infinity()
+                                : static_cast<double>(evaluations) / static_cast<double>(became_feasible);
+}
+
+GradientRepair::GradientRepair(double prob, size_t max_steps, double fd_step)
+    : _prob(prob), _max_steps(max_steps), _fd_step(fd_step)
+{
+    if (prob < 0 || prob > 1)
+        throw ConfigError("repair_prob should be in [0, 1]");
+    if (fd_step <= 0)
+        throw ConfigError("repair_fd_step should be positive");
+}
+bool GradientRepair::_newton_step(const DE& de, const Solution& x, const Evaluated& fx,
+                                  const vector<Evaluated>& probes, const vector<double>& hs, Solution& out) const
+{
+    const size_t dim = de.dimension();
+    vector<size_t> violated;
+    for (size_t k = 0; k < fx.second.size(); ++k)
+        if (fx.second[k] > 0)
+            violated.push_back(k);
+    const size_t m = violated.size();
+    vector<vector<double>> jacobian(m, vector<double>(dim, 0));
+    for (size_t j = 0; j < dim; ++j)
+    {
+        const ConstraintViolation& vio = probes[j].second;
+        if (vio.size() != fx.second.size())
+            return false;
+        for (size_t r = 0; r < m; ++r)
+            jacobian[r][j] = hs[j] == 0 ? 0 : (vio[violated[r]] - fx.second[violated[r]]) / hs[j];
+    }
+    // minimum-norm step: dx = -J^T (J J^T)^-1 C
+    vector<vector<double>> jjt(m, vector<double>(m, 0));
+    vector<double> rhs(m);
+    double trace = 0;
+    for (size_t r = 0; r < m; ++r)
+    {
+        for (size_t c = 0; c < m; ++c)
+            jjt[r][c] = inner_product(jacobian[r].begin(), jacobian[r].end(), jacobian[c].begin(), 0.0);
+        rhs[r] = fx.second[violated[r]];
+        trace += jjt[r][r];
+    }
+    if (!(trace > 0) || std::isinf(trace))
+        return false;
+    for (size_t r = 0; r < m; ++r)
+        jjt[r][r] += 1e-12 * trace; // regularization for linearly dependent constraints
+    if (!solve_linear(jjt, rhs))
+        return false;
+    out = x;
+    for (size_t j = 0; j < dim; ++j)
+    {
+        double dx = 0;
+        for (size_t r = 0; r < m; ++r)
+            dx += jacobian[r][j] * rhs[r];
+        const auto rg = de.range(j);
+        out[j]        = static_cast<Scalar>(min(rg.second, max(rg.first, x[j] - dx)));
+    }
+    return true;
+}
+void GradientRepair::repair(const DE& de, const BatchEvaluator& probe, const BatchEvaluator& evaluate,
+                            vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    assert(trials.size() == trial_results.size());
+    const size_t dim = de.dimension();
+    uniform_real_distribution<double> distr(0, 1);
+    vector<size_t> active;
+    vector<double> before;
+    for (size_t i = 0; i < trials.size(); ++i)
+    {
+        const double vio = total_violation(trial_results[i]);
+        if (vio > 0 && !std::isinf(vio) && !std::isnan(vio) && distr(engine) < _prob)
+        {
+            active.push_back(i);
+            before.push_back(vio);
+        }
+    }
+    const vector<size_t> attempted(active);
+    _stats.attempted += attempted.size();
+    for (size_t step = 0; step < _max_steps && !active.empty(); ++step)
+    {
+        vector<Solution> probes;
+        vector<size_t> probe_owners;
+        vector<double> hs;
+        probes.reserve(active.size() * dim);
+        probe_owners.reserve(active.size() * dim);
+        hs.reserve(active.size() * dim);
+        for (size_t i : active)
+        {
+            for (size_t j = 0; j < dim; ++j)
+            {
+                const auto rg = de.range(j);
+                double h      = _fd_step * (rg.second > rg.first ? rg.second - rg.first : 1.0);
+                Solution x(trials[i]);
+                if (x[j] + h > rg.second)
+                    h = -h;
+                x[j] += static_cast<Scalar>(h);
+                probes.push_back(x);
+                probe_owners.push_back(i);
+                hs.push_back(static_cast<double>(x[j]) - static_cast<double>(trials[i][j])); // step after rounding
+            }
+        }
+        vector<Evaluated> probe_results(probes.size());
+        probe(probes, probe_owners, probe_results);
+        _stats.evaluations += probes.size();
+
+        vector<size_t> moved;
+        vector<Solution> repaired;
+        for (size_t a = 0; a < active.size(); ++a)
+        {
+            const size_t i = active[a];
+            const vector<Evaluated> fd(probe_results.begin() + a * dim, probe_results.begin() + (a + 1) * dim);
+            const vector<double> h(hs.begin() + a * dim, hs.begin() + (a + 1) * dim);
+            Solution x;
+            if (_newton_step(de, trials[i], trial_results[i], fd, h, x))
+            {
+                moved.push_back(i);
+                repaired.push_back(x);
+            }
+        }
+        vector<Evaluated> repaired_results(repaired.size());
+        evaluate(repaired, moved, repaired_results);
+        _stats.evaluations += repaired.size();
+
+        active.clear();
+        for (size_t a = 0; a < moved.size(); ++a)
+        {
+            const size_t i   = moved[a];
+            const double vio = total_violation(repaired_results[a]);
+            if (vio < total_violation(trial_results[i]))
+            {
+                trials[i]        = repaired[a];
+                trial_results[i] = repaired_results[a];
+                if (vio > 0)
+                    active.push_back(i);
+            }
+        }
+    }
+    for (size_t a = 0; a < attempted.size(); ++a)
+    {
+        const double after = total_violation(trial_results[attempted[a]]);
+        _stats.violation_before += before[a];
+        _stats.violation_after += after;
+        _stats.improved += after < before[a] ? 1 : 0;
+        _stats.became_feasible += after == 0 ? 1 : 0;
+    }
+}
+void GradientRepair::report(ostream& os) const
+{
+    os << "Gradient repair attempted: " << _stats.attempted << ", improved: " << _stats.improved
+       << ", became feasible: " << _stats.became_feasible << ", extra evaluations: " << _stats.evaluations
+       << ", evaluations per feasible: " << _stats.evaluations_per_feasible()
+       << ", violation: " << _stats.violation_before << " -> " << _stats.violation_after << endl;
+}
@@ -0,0 +1,435 @@
+#include "DE/LocalSearch.h"
+#include "DE/DEOrigin.h"
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+#include <cmath>
+#include <limits>
+using namespace std;
+namespace
+{
+const double inf = numeric_limits<double>::infinity();
+bool feasible(const Evaluated& e)
+{
+    return accumulate(e.second.begin(), e.second.end(), 0.0) == 0;
+}
+// from a feasible start the FOM with the infeasible region as a barrier, so that the refined point
+// stays feasible under every selector, from an infeasible start the total violation
+double merit(const Evaluated& e, bool feasible_start)
+{
+    const double v = accumulate(e.second.begin(), e.second.end(), 0.0);
+    const double m = feasible_start ? (v == 0 ? e.first : inf) : v;
+    return std::isnan(m) ? inf : m;
+}
+double dot(const vector<double>& a, const vector<double>& b)
+{
+    return inner_product(a.begin(), a.end(), b.begin(), 0.0);
+}
+// Evaluates the points of one job inside the ranges and within its budget, and keeps the best
+class Probe
+{
+public:
+    Probe(const LocalSearch::PointObjective& f, size_t idx, const vector<double>& lo, const vector<double>& hi,
+          size_t budget, const atomic<bool>& stop, const Solution& x0, const Evaluated& r0)
+        : _f(f), _idx(idx), _lo(lo), _hi(hi), _budget(budget), _stop(stop), _evals(0),
+          _feasible_start(feasible(r0)), _point(x0), _best_x(x0), _best_result(r0),
+          _best_merit(merit(r0, _feasible_start))
+    {
+    }
+    bool exhausted() const noexcept { return _evals >= _budget || _stop.load(memory_order_relaxed); }
+    double lo(size_t j) const noexcept { return _lo[j]; }
+    double hi(size_t j) const noexcept { return _hi[j]; }
+    // clamp x into the ranges, then evaluate it; +inf once the budget is spent
+    double operator()(vector<double>& x)
+    {
+        for (size_t j = 0; j < x.size(); ++j)
+            x[j] = min(max(x[j], _lo[j]), _hi[j]);
+        if (exhausted())
+            return inf;
+        copy(x.begin(), x.end(), _point.begin());
+        const Evaluated r = _f(_idx, _point);
+        ++_evals;
+        const double m = merit(r, _feasible_start);
+        if (m < _best_merit)
+        {
+            _best_x      = _point;
+            _best_result = r;
+            _best_merit  = m;
+        }
+        return m;
+    }
+    size_t evaluations() const noexcept { return _evals; }
+    const Solution& best_x() const noexcept { return _best_x; }
+    const Evaluated& best_result() const noexcept { return _best_result; }
+
+private:
+    const LocalSearch::PointObjective& _f;
+    const size_t _idx;
+    const vector<double>& _lo;
+    const vector<double>& _hi;
+    const size_t _budget;
+    const atomic<bool>& _stop;
+    size_t _evals;
+    const bool _feasible_start;
+    Solution _point;
+    Solution _best_x;
+    Evaluated _best_result;
+    double _best_merit;
+};
+// Nelder-Mead with the dimension-adaptive coefficients of Gao & Han (2012), true on convergence
+bool nelder_mead(Probe& p, const vector<double>& x0, double f0, const vector<double>& width, double tol)
+{
+    const size_t n      = x0.size();
+    const double dn     = static_cast<double>(n);
+    const double expand = 1 + 2 / dn;
+    const double shrink = max(1 - 1 / dn, 0.5);
+    const double contract = max(0.75 - 1 / (2 * dn), 0.5);
+    vector<vector<double>> s(n + 1, x0);
+    vector<double> fs(n + 1, f0);
+    for (size_t j = 0; j < n; ++j)
+    {
+        const double step = 0.05 * width[j];
+        s[j + 1][j] += x0[j] + step <= p.hi(j) ? step : -step;
+        fs[j + 1] = p(s[j + 1]);
+    }
+    vector<size_t> order(n + 1);
+    vector<double> c(n), xr(n), xe(n), xc(n);
+    while (!p.exhausted())
+    {
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fs[a] < fs[b]; });
+        const size_t b = order[0], w = order[n], sw = order[n - 1];
+        if (std::isinf(fs[b]))
+            return false;
+        if (fs[w] - fs[b] <= tol * (fabs(fs[b]) + tol))
+            return true;
+        fill(c.begin(), c.end(), 0.0);
+        for (size_t k = 0; k < n; ++k)
+            for (size_t j = 0; j < n; ++j)
+                c[j] += s[order[k]][j] / dn;
+        for (size_t j = 0; j < n; ++j)
+            xr[j] = 2 * c[j] - s[w][j];
+        const double fr = p(xr);
+        if (fr < fs[b])
+        {
+            for (size_t j = 0; j < n; ++j)
+                xe[j] = c[j] + expand * (xr[j] - c[j]);
+            const double fe = p(xe);
+            s[w].swap(fe < fr ? xe : xr);
+            fs[w] = min(fe, fr);
+            continue;
+        }
+        if (fr < fs[sw])
+        {
+            s[w].swap(xr);
+            fs[w] = fr;
+            continue;
+        }
+        // outside contraction if the reflection is better than the worst, inside otherwise
+        const vector<double>& toward = fr < fs[w] ? xr : s[w];
+        for (size_t j = 0; j < n; ++j)
+            xc[j] = c[j] + contract * (toward[j] - c[j]);
+        const double fc = p(xc);
+        if (fc < min(fr, fs[w]))
+        {
+            s[w].swap(xc);
+            fs[w] = fc;
+            continue;
+        }
+        for (size_t k = 1; k <= n && !p.exhausted(); ++k)
+        {
+            vector<double>& v = s[order[k]];
+            for (size_t j = 0; j < n; ++j)
+                v[j] = s[b][j] + shrink * (v[j] - s[b][j]);
+            fs[order[k]] = p(v);
+        }
+    }
+    return false;
+}
+// forward differences, backward at the upper bound; false if a probe is infinite
+bool gradient(Probe& p, const vector<double>& x, double fx, const vector<double>& width, double fd_step,
+              vector<double>& g, vector<double>& probe)
+{
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+        probe     = x;
+        probe[j] += x[j] + fd_step * width[j] <= p.hi(j) ? fd_step * width[j] : -fd_step * width[j];
+        double fp = p(probe);
+        if (std::isinf(fp))
+        {
+            // the forward probe left the feasible region, try the other side
+            probe[j] = 2 * x[j] - probe[j];
+            fp       = p(probe);
+        }
+        const double h = probe[j] - x[j];
+        if (std::isinf(fp))
+            return false;
+        g[j] = h == 0 ? 0 : (fp - fx) / h;
+    }
+    return true;
+}
+// Projected BFGS on the inverse Hessian with an Armijo backtracking line search, the coordinates
+// at a bound whose step would leave the box are held fixed; true on convergence
+bool quasi_newton(Probe& p, vector<double> x, double fx, const vector<double>& width, double fd_step, double tol)
+{
+    const size_t n = x.size();
+    vector<double> h(n * n, 0), g(n), gn(n), d(n), xn(n), s(n), y(n), hy(n), probe(n);
+    auto reset = [&](double scale) {
+        fill(h.begin(), h.end(), 0.0);
+        for (size_t i = 0; i < n; ++i)
+            h[i * n + i] = scale;
+    };
+    if (std::isinf(fx) || !gradient(p, x, fx, width, fd_step, g, probe))
+        return false;
+    // the first step moves about 1% of the box
+    const double gnorm = sqrt(dot(g, g));
+    reset(gnorm == 0 ? 1 : 0.01 * sqrt(dot(width, width)) / gnorm);
+    bool fresh = true;
+    while (!p.exhausted())
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            d[i] = -inner_product(h.begin() + i * n, h.begin() + (i + 1) * n, g.begin(), 0.0);
+            if ((x[i] <= p.lo(i) && d[i] < 0) || (x[i] >= p.hi(i) && d[i] > 0))
+                d[i] = 0;
+        }
+        if (dot(g, d) >= 0)
+        {
+            if (fresh)
+                return true; // no descent direction left inside the box
+            reset(1);
+            fresh = true;
+            continue;
+        }
+        double fn     = inf;
+        bool accepted = false;
+        for (double alpha = 1; alpha > 1e-10 && !p.exhausted(); alpha *= 0.5)
+        {
+            for (size_t i = 0; i < n; ++i)
+                xn[i] = x[i] + alpha * d[i];
+            fn = p(xn);
+            for (size_t i = 0; i < n; ++i)
+                s[i] = xn[i] - x[i];
+            if (fn <= fx + 1e-4 * dot(g, s))
+            {
+                accepted = true;
+                break;
+            }
+        }
+        if (!accepted)
+        {
+            if (fresh)
+                return !p.exhausted();
+            reset(1);
+            fresh = true;
+            continue;
+        }
+        const bool flat = fx - fn <= tol * (fabs(fx) + tol);
+        if (flat || !gradient(p, xn, fn, width, fd_step, gn, probe))
+            return flat;
+        for (size_t i = 0; i < n; ++i)
+            y[i] = gn[i] - g[i];
+        const double sy = dot(s, y);
+        if (sy > 1e-12 * sqrt(dot(s, s) * dot(y, y)))
+        {
+            if (fresh)
+                reset(sy / dot(y, y));
+            // H += (sy + y'Hy) / sy^2 * s s' - (Hy s' + s (Hy)') / sy
+            for (size_t i = 0; i < n; ++i)
+                hy[i] = inner_product(h.begin() + i * n, h.begin() + (i + 1) * n, y.begin(), 0.0);
+            const double a = (sy + dot(y, hy)) / (sy * sy);
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j)
+                    h[i * n + j] += a * s[i] * s[j] - (hy[i] * s[j] + s[i] * hy[j]) / sy;
+            fresh = false;
+        }
+        x.swap(xn);
+        g.swap(gn);
+        fx = fn;
+    }
+    return false;
+}
+}
+LocalSearch::LocalSearch(const LocalSearchConfig& conf)
+    : _conf(conf), _epoch(0), _pending(0), _quit(false), _running(false), _stop(false), _launched_at(0),
+      _counter(nullptr)
+{
+    if (conf.period == 0)
+        throw ConfigError("ls_period should be positive");
+    if (conf.top_k == 0)
+        throw ConfigError("ls_top_k should be positive");
+    if (conf.share <= 0 || conf.share >= 1)
+        throw ConfigError("ls_share should be in (0, 1)");
+    if (conf.fd_step <= 0)
+        throw ConfigError("ls_fd_step should be positive");
+    if (conf.tol < 0)
+        throw ConfigError("ls_tol should be non-negative");
+}
+LocalSearch::~LocalSearch()
+{
+    stop();
+    _join();
+    {
+        lock_guard<mutex> lk(_m);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (auto& t : _threads)
+        t.join();
+}
+void LocalSearch::_work(size_t k)
+{
+    size_t seen = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> lk(_m);
+            _wake.wait(lk, [&]() { return _quit || _epoch != seen; });
+            if (_quit)
+                return;
+            seen = _epoch;
+            if (k >= _jobs.size())
+                continue; // fewer points than workers this time
+        }
+        _task(k);
+        lock_guard<mutex> lk(_m);
+        if (--_pending == 0)
+            _done.notify_all();
+    }
+}
+void LocalSearch::_join() noexcept
+{
+    unique_lock<mutex> lk(_m);
+    _done.wait(lk, [&]() { return _pending == 0; });
+    _running = false;
+}
+size_t LocalSearch::allowance(size_t total_evaluations) const noexcept
+{
+    // keep spent / total <= share, counting what this job may spend
+    const double de_evals = static_cast<double>(total_evaluations - _stats.evaluations);
+    const double allowed  = _conf.share / (1 - _conf.share) * de_evals - static_cast<double>(_stats.evaluations);
+    return allowed <= 0 ? 0 : static_cast<size_t>(allowed);
+}
+void LocalSearch::launch(const DE& de, size_t gen, const vector<size_t>& indices, size_t budget,
+                         const PointObjective& f, EvalScheduler& counter)
+{
+    assert(!running());
+    const size_t dim = de.dimension();
+    vector<double> lo(dim), hi(dim), width(dim);
+    for (size_t j = 0; j < dim; ++j)
+    {
+        lo[j]    = de.range(j).first;
+        hi[j]    = de.range(j).second;
+        width[j] = hi[j] - lo[j];
+    }
+    _jobs.clear();
+    for (size_t i : indices)
+    {
+        const Solution& x = de.population()[i];
+        if (find(_polished.begin(), _polished.end(), x) != _polished.end())
+            continue;
+        Job job;
+        job.out.origin       = i;
+        job.out.x            = x;
+        job.out.result       = de.evaluated()[i];
+        job.out.start_result = de.evaluated()[i];
+        _jobs.push_back(job);
+    }
+    if (_jobs.empty())
+        return;
+    _stop.store(false);
+    _launched_at = gen;
+    _counter     = &counter;
+    _running     = true;
+    ++_stats.launches;
+    // `_jobs` is complete before the workers are woken, so its elements never move
+    // job k evaluates with the objective index NP + k, concurrent DE evaluations use 0 .. NP - 1
+    const size_t first_slot = de.np();
+    _task = [this, f, lo, hi, width, budget, first_slot](size_t k) {
+        Job& job = _jobs[k];
+        try
+        {
+            Probe p(f, first_slot + k, lo, hi, budget, _stop, job.out.x, job.out.start_result);
+            const vector<double> x0(job.out.x.begin(), job.out.x.end());
+            const double f0 = merit(job.out.start_result, feasible(job.out.start_result));
+            job.converged   = _conf.method == NelderMead
+                                ? nelder_mead(p, x0, f0, width, _conf.tol)
+                                : quasi_newton(p, x0, f0, width, _conf.fd_step, _conf.tol);
+            job.out.x       = p.best_x();
+            job.out.result  = p.best_result();
+            job.evaluations = p.evaluations();
+        }
+        catch (...)
+        {
+            job.error = current_exception();
+        }
+    };
+    {
+        lock_guard<mutex> lk(_m);
+        _pending = _jobs.size();
+        ++_epoch;
+    }
+    while (_threads.size() < _conf.top_k)
+        _threads.emplace_back(&LocalSearch::_work, this, _threads.size());
+    _wake.notify_all();
+}
+vector<LocalSearch::Refined> LocalSearch::collect()
+{
+    _join();
+    vector<Refined> improved;
+    exception_ptr error;
+    size_t spent = 0;
+    for (Job& job : _jobs)
+    {
+        spent += job.evaluations;
+        if (job.error && !error)
+            error = job.error;
+        if (job.error)
+            continue;
+        ++_stats.refined;
+        if (job.converged)
+            _polished.push_back(job.out.x);
+        const bool feasible_start = feasible(job.out.start_result);
+        if (merit(job.out.result, feasible_start) < merit(job.out.start_result, feasible_start))
+        {
+            ++_stats.improved;
+            improved.push_back(job.out);
+        }
+    }
+    // remember only the most recent polished points
+    if (_polished.size() > 4 * _conf.top_k)
+        _polished.erase(_polished.begin(), _polished.end() - 4 * _conf.top_k);
+    _stats.evaluations += spent;
+    if (_counter != nullptr)
+        _counter->count(spent);
+    _jobs.clear();
+    if (error)
+        rethrow_exception(error);
+    return improved;
+}
+void LocalSearch::reset()
+{
+    stop();
+    _join();
+    size_t spent = 0;
+    for (const Job& job : _jobs)
+        spent += job.evaluations;
+    _stats.evaluations += spent;
+    if (_counter != nullptr)
+        _counter->count(spent);
+    _jobs.clear();
+    _polished.clear();
+}
+double LocalSearch::fraction(size_t total_evaluations) const noexcept
+{
+    return total_evaluations == 0
+               ? 0
+               : static_cast<double>(_stats.evaluations) / static_cast<double>(total_evaluations);
+}
+void LocalSearch::report(ostream& os, size_t total_evaluations) const
+{
+    os << "Local search (" << (_conf.method == NelderMead ? "nelder-mead" : "quasi-newton")
+       << "): launches: " << _stats.launches << ", refined: " << _stats.refined << ", improved: " << _stats.improved
+       << ", injected: " << _stats.injected << ", evaluations: " << _stats.evaluations << " ("
+       << 100 * fraction(total_evaluations) << "% of " << total_evaluations << ")" << endl;
+}
@@ -0,0 +1,404 @@
+#include "DE/Metrics.h"
+#include "DE/EvalScheduler.h"
+#include "DE/DEConfig.h"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#if defined(__unix__) || defined(__APPLE__)
+#define DE_METRICS_SOCKETS
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+using namespace std;
+const char* const phase_names[NumPhases] = {"init", "variation", "evaluation", "repair", "selection", "local_search"};
+const size_t Metrics::max_strategies;
+namespace
+{
+int64_t now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+string number(double v)
+{
+    if (std::isnan(v))
+        return "NaN";
+    if (std::isinf(v))
+        return v > 0 ? "+Inf" : "-Inf";
+    ostringstream os;
+    os << setprecision(12) << v;
+    return os.str();
+}
+string escape(const string& s)
+{
+    string out;
+    for (char c : s)
+    {
+        if (c == '\\' || c == '"')
+            out += '\\';
+        out += c == '\n' ? 'n' : c;
+    }
+    return out;
+}
+void family(ostream& os, const char* name, const char* type, const char* help)
+{
+    os << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+}
+Metrics::Metrics() : _scheduler(nullptr)
+{
+    _running.store(false);
+    _generation.store(0);
+    _start_evals.store(0);
+    _start_ns.store(now_ns());
+    _end_ns.store(_start_ns.load());
+    _best_fom.store(numeric_limits<double>::quiet_NaN());
+    _best_violation.store(numeric_limits<double>::quiet_NaN());
+    _has_epsilon.store(false);
+    _epsilon.store(0);
+    _num_strategies.store(0);
+    for (auto& p : _strategy_prob)
+        p.store(0);
+    for (auto& t : _phase_ns)
+        t.store(0);
+}
+void Metrics::start() noexcept
+{
+    _generation.store(0, memory_order_relaxed);
+    _start_evals.store(evaluations(), memory_order_relaxed);
+    _start_ns.store(now_ns(), memory_order_relaxed);
+    _running.store(true, memory_order_relaxed);
+}
+void Metrics::set_running(bool r) noexcept
+{
+    if (!r)
+        _end_ns.store(now_ns(), memory_order_relaxed);
+    _running.store(r, memory_order_relaxed);
+}
+void Metrics::set_best(double fom, double violation) noexcept
+{
+    _best_fom.store(fom, memory_order_relaxed);
+    _best_violation.store(violation, memory_order_relaxed);
+}
+void Metrics::set_epsilon(double level) noexcept
+{
+    _epsilon.store(level, memory_order_relaxed);
+    _has_epsilon.store(true, memory_order_relaxed);
+}
+void Metrics::set_strategy_probabilities(const vector<double>& probs) noexcept
+{
+    const size_t n = min(probs.size(), max_strategies);
+    for (size_t i = 0; i < n; ++i)
+        _strategy_prob[i].store(probs[i], memory_order_relaxed);
+    _num_strategies.store(n, memory_order_relaxed);
+}
+void Metrics::add_phase(SolverPhase p, double seconds) noexcept
+{
+    _phase_ns[p].fetch_add(static_cast<uint64_t>(seconds * 1e9), memory_order_relaxed);
+}
+size_t Metrics::evaluations() const noexcept
+{
+    return _scheduler == nullptr ? 0 : _scheduler->evaluations();
+}
+double Metrics::evaluations_per_second() const noexcept
+{
+    const int64_t end = running() ? now_ns() : _end_ns.load(memory_order_relaxed);
+    const double dt   = 1e-9 * static_cast<double>(end - _start_ns.load(memory_order_relaxed));
+    const size_t n  = evaluations() - _start_evals.load(memory_order_relaxed);
+    return dt <= 0 ? 0 : static_cast<double>(n) / dt;
+}
+vector<double> Metrics::strategy_probabilities() const
+{
+    vector<double> probs(_num_strategies.load(memory_order_relaxed));
+    for (size_t i = 0; i < probs.size(); ++i)
+        probs[i] = _strategy_prob[i].load(memory_order_relaxed);
+    return probs;
+}
+double Metrics::phase_seconds(SolverPhase p) const noexcept
+{
+    return 1e-9 * static_cast<double>(_phase_ns[p].load(memory_order_relaxed));
+}
+PhaseTimer::~PhaseTimer()
+{
+    _m.add_phase(_p, chrono::duration<double>(chrono::steady_clock::now() - _t0).count());
+}
+
+void MetricsServer::add(const string& run, const Metrics& m)
+{
+    lock_guard<mutex> lk(_m);
+    for (auto& r : _runs)
+    {
+        if (r.first == run)
+        {
+            r.second = &m;
+            return;
+        }
+    }
+    _runs.emplace_back(run, &m);
+}
+void MetricsServer::remove(const string& run)
+{
+    lock_guard<mutex> lk(_m);
+    _runs.erase(remove_if(_runs.begin(), _runs.end(),
+                          [&](const pair<string, const Metrics*>& r) { return r.first == run; }),
+                _runs.end());
+}
+void MetricsServer::write(ostream& os) const
+{
+    lock_guard<mutex> lk(_m);
+    auto each = [&](const char* name, double (*value)(const Metrics&)) {
+        for (const auto& r : _runs)
+            os << name << "{run=\"" << escape(r.first) << "\"} " << number(value(*r.second)) << "\n";
+    };
+    family(os, "de_running", "gauge", "1 while the solver runs");
+    each("de_running", [](const Metrics& m) { return m.running() ? 1.0 : 0.0; });
+    family(os, "de_generation", "gauge", "Current generation");
+    each("de_generation", [](const Metrics& m) { return static_cast<double>(m.generation()); });
+    family(os, "de_evaluations_total", "counter", "Objective evaluations");
+    each("de_evaluations_total", [](const Metrics& m) { return static_cast<double>(m.evaluations()); });
+    family(os, "de_evaluations_per_second", "gauge", "Evaluation rate since the run started");
+    each("de_evaluations_per_second", [](const Metrics& m) { return m.evaluations_per_second(); });
+    family(os, "de_best_fom", "gauge", "Figure of merit of the best individual");
+    each("de_best_fom", [](const Metrics& m) { return m.best_fom(); });
+    family(os, "de_best_violation", "gauge", "Total constraint violation of the best individual");
+    each("de_best_violation", [](const Metrics& m) { return m.best_violation(); });
+    family(os, "de_epsilon_level", "gauge", "Epsilon level of the epsilon constrained selector");
+    for (const auto& r : _runs)
+        if (r.second->has_epsilon())
+            os << "de_epsilon_level{run=\"" << escape(r.first) << "\"} " << number(r.second->epsilon()) << "\n";
+    family(os, "de_strategy_probability", "gauge", "SaDE strategy probabilities");
+    for (const auto& r : _runs)
+    {
+        const vector<double> probs = r.second->strategy_probabilities();
+        for (size_t i = 0; i < probs.size(); ++i)
+            os << "de_strategy_probability{run=\"" << escape(r.first) << "\",strategy=\"" << i << "\"} "
+               << number(probs[i]) << "\n";
+    }
+    family(os, "de_phase_seconds_total", "counter", "Time spent by the solver thread in each phase");
+    for (const auto& r : _runs)
+        for (size_t p = 0; p < NumPhases; ++p)
+            os << "de_phase_seconds_total{run=\"" << escape(r.first) << "\",phase=\"" << phase_names[p] << "\"} "
+               << number(r.second->phase_seconds(static_cast<SolverPhase>(p))) << "\n";
+}
+#ifdef DE_METRICS_SOCKETS
+namespace
+{
+void send_all(int fd, const string& data)
+{
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a client that hangs up must not kill the process
+#else
+    const int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, flags);
+        if (n <= 0)
+            return;
+        sent += static_cast<size_t>(n);
+    }
+}
+// "unix:/path", or a TCP port on the loopback interface: "9100", "localhost:9100", "127.0.0.1:9100"
+bool parse_address(const string& address, string& unix_path, int& port)
+{
+    if (address.compare(0, 5, "unix:") == 0)
+    {
+        unix_path = address.substr(5);
+        return !unix_path.empty() && unix_path.size() < sizeof(sockaddr_un::sun_path);
+    }
+    string p = address;
+    for (const char* host : {"localhost:", "127.0.0.1:"})
+        if (p.compare(0, strlen(host), host) == 0)
+            p = p.substr(strlen(host));
+    if (p.empty() || p.find_first_not_of("0123456789") != string::npos || p.size() > 5)
+        return false;
+    port = stoi(p);
+    return port <= 65535;
+}
+int open_socket(const string& unix_path, int port, bool listening, string& bound)
+{
+    const int fd = socket(unix_path.empty() ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw runtime_error(string("socket: ") + strerror(errno));
+    int rc;
+    if (!unix_path.empty())
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, unix_path.c_str(), sizeof(addr.sun_path) - 1);
+        struct stat st;
+        if (listening && lstat(unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(unix_path.c_str()); // left over by a previous run
+        rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                       : connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        bound = "unix:" + unix_path;
+    }
+    else
+    {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listening)
+        {
+            const int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            rc = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            socklen_t len = sizeof(addr);
+            if (rc == 0)
+                getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        }
+        else
+            rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        bound = "127.0.0.1:" + to_string(ntohs(addr.sin_port));
+    }
+    if (rc == 0 && listening)
+        rc = listen(fd, 16);
+    if (rc != 0)
+    {
+        const string err = strerror(errno);
+        close(fd);
+        throw runtime_error("metrics " + bound + ": " + err);
+    }
+    return fd;
+}
+}
+MetricsServer::MetricsServer(const string& address) : _fd(-1), _stop(false)
+{
+    int port = 0;
+    if (!parse_address(address, _unix_path, port))
+        throw ConfigError("Invalid metrics address: " + address);
+    _fd     = open_socket(_unix_path, port, true, _address);
+    _thread = thread([this]() { _serve(); });
+}
+MetricsServer::~MetricsServer()
+{
+    _stop.store(true);
+    _thread.join();
+    close(_fd);
+    if (!_unix_path.empty())
+        unlink(_unix_path.c_str());
+}
+void MetricsServer::_serve()
+{
+    // the clients are polled together with the listening socket, a slow or silent client
+    // delays its own answer only, never another scrape
+    struct Client
+    {
+        int fd;
+        string request;
+        chrono::steady_clock::time_point accepted;
+    };
+    const auto raw_wait = chrono::milliseconds(100); // a client silent that long gets the text
+    const auto max_wait = chrono::milliseconds(1000); // to complete an HTTP request
+    vector<Client> clients;
+    vector<pollfd> fds;
+    char buf[1024];
+    while (!_stop.load())
+    {
+        fds.assign(1, pollfd{_fd, POLLIN, 0});
+        for (const auto& c : clients)
+            fds.push_back(pollfd{c.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), clients.empty() ? 100 : 10) < 0)
+            continue;
+        const auto now = chrono::steady_clock::now();
+        for (size_t k = clients.size(); k-- > 0;)
+        {
+            Client& c = clients[k];
+            bool done = false;
+            if (fds[k + 1].revents != 0)
+            {
+                const ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+                if (n > 0)
+                    c.request.append(buf, static_cast<size_t>(n));
+                // an HTTP request ends with an empty line
+                done = n <= 0 || c.request.find("\r\n\r\n") != string::npos ||
+                       c.request.find("\n\n") != string::npos || c.request.size() > 8192;
+            }
+            if (done || now - c.accepted >= (c.request.empty() ? raw_wait : max_wait))
+            {
+                _answer(c.fd, c.request);
+                close(c.fd);
+                clients.erase(clients.begin() + static_cast<ptrdiff_t>(k));
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            const int client = accept(_fd, nullptr, nullptr);
+            if (client >= 0)
+                clients.push_back(Client{client, string(), now});
+        }
+    }
+    for (const auto& c : clients)
+        close(c.fd);
+}
+void MetricsServer::_answer(int client, const string& request) const
+{
+    ostringstream body;
+    write(body);
+    if (request.empty())
+    {
+        send_all(client, body.str()); // a raw client sends nothing
+        return;
+    }
+    const size_t sp  = request.find(' ', 4);
+    const string path = request.compare(0, 4, "GET ") == 0 ? request.substr(4, sp - 4) : "";
+    string status     = "200 OK";
+    string text       = body.str();
+    if (path != "/metrics" && path != "/")
+    {
+        status = "404 Not Found";
+        text   = "Not found, try /metrics\n";
+    }
+    send_all(client, "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                         to_string(text.size()) + "\r\nConnection: close\r\n\r\n" + text);
+}
+string MetricsServer::fetch(const string& address)
+{
+    string unix_path, bound;
+    int port = 0;
+    if (!parse_address(address, unix_path, port))
+        throw ConfigError("Invalid metrics address: " + address);
+    const int fd = open_socket(unix_path, port, false, bound);
+    send_all(fd, "GET /metrics HTTP/1.0\r\n\r\n");
+    string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        response.append(buf, static_cast<size_t>(n));
+    close(fd);
+    const size_t body = response.find("\r\n\r\n");
+    if (response.compare(0, 5, "HTTP/") == 0 && body != string::npos)
+        return response.substr(body + 4);
+    return response;
+}
+#else
+MetricsServer::MetricsServer(const string&) : _fd(-1), _stop(false)
+{
+    throw runtime_error("The metrics server requires POSIX sockets");
+}
+MetricsServer::~MetricsServer()
+{
+}
+void MetricsServer::_serve()
+{
+}
+void MetricsServer::_answer(int, const string&) const
+{
+}
+string MetricsServer::fetch(const string&)
+{
+    throw runtime_error("The metrics server requires POSIX sockets");
+}
+#endif
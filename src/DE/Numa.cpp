@@ -0,0 +1,177 @@
+#include "DE/Numa.h"
+#include "DE/DEConfig.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <omp.h>
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+using namespace std;
+vector<int> parse_cpu_list(const string& list)
+{
+    vector<int> cpus;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        const size_t dash = item.find('-');
+        try
+        {
+            const int lo = stoi(item.substr(0, dash));
+            const int hi = dash == string::npos ? lo : stoi(item.substr(dash + 1));
+            if (lo < 0 || hi < lo)
+                throw invalid_argument(item);
+            for (int c = lo; c <= hi; ++c)
+                cpus.push_back(c);
+        }
+        catch (const logic_error&)
+        {
+            throw ConfigError("Invalid cpu list: " + list);
+        }
+    }
+    return cpus;
+}
+bool pin_thread(int cpu)
+{
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+NumaTopology NumaTopology::detect()
+{
+    NumaTopology topo;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return topo;
+    vector<int> node_ids;
+    if (DIR* dir = opendir("/sys/devices/system/node"))
+    {
+        while (dirent* ent = readdir(dir))
+        {
+            const string name = ent->d_name;
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                all_of(name.begin() + 4, name.end(), [](char c) -> bool { return c >= '0' && c <= '9'; }))
+                node_ids.push_back(stoi(name.substr(4)));
+        }
+        closedir(dir);
+    }
+    sort(node_ids.begin(), node_ids.end());
+    for (int id : node_ids)
+    {
+        ifstream ifs("/sys/devices/system/node/node" + to_string(id) + "/cpulist");
+        string list;
+        if (!getline(ifs, list) || list.empty())
+            continue; // memory-only node
+        vector<int> cpus;
+        for (int c : parse_cpu_list(list))
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                cpus.push_back(c);
+        if (!cpus.empty())
+            topo.node_cpus.push_back(cpus);
+    }
+    if (topo.node_cpus.empty())
+    {
+        vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &allowed))
+                cpus.push_back(c);
+        topo.node_cpus.push_back(cpus);
+    }
+#endif
+    return topo;
+}
+
+NumaTeam::NumaTeam(size_t num_threads)
+    : _topology(NumaTopology::detect()), _size(0), _task(nullptr), _n(0), _remaining(0), _generation(0), _stop(false)
+{
+    if (num_threads == 0)
+        num_threads = static_cast<size_t>(omp_get_max_threads());
+    _size = num_threads;
+    const size_t nodes = max<size_t>(_topology.nodes(), 1);
+    _node.resize(num_threads);
+    _cpu.resize(num_threads, -1);
+    vector<size_t> placed(nodes, 0);
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        _node[t] = t * nodes / num_threads;
+        if (_topology.nodes() > 0)
+        {
+            const vector<int>& cpus = _topology.node_cpus[_node[t]];
+            _cpu[t]                 = cpus[placed[_node[t]]++ % cpus.size()];
+        }
+    }
+    for (size_t t = 0; t < num_threads; ++t)
+        _threads.emplace_back(&NumaTeam::_work, this, t);
+}
+NumaTeam::~NumaTeam()
+{
+    {
+        lock_guard<mutex> lk(_m);
+        _stop = true;
+    }
+    _start.notify_all();
+    for (auto& t : _threads)
+        t.join();
+}
+void NumaTeam::run(size_t n, const Task& task)
+{
+    if (n == 0)
+        return;
+    lock_guard<mutex> run_lk(_run_m);
+    unique_lock<mutex> lk(_m);
+    _task      = &task;
+    _n         = n;
+    _remaining = size();
+    _error     = nullptr;
+    ++_generation;
+    _start.notify_all();
+    _done.wait(lk, [this]() -> bool { return _remaining == 0; });
+    _task = nullptr;
+    if (_error)
+        rethrow_exception(_error);
+}
+void NumaTeam::_work(size_t id)
+{
+    if (_cpu[id] >= 0)
+        pin_thread(_cpu[id]);
+    uint64_t seen = 0;
+    for (;;)
+    {
+        unique_lock<mutex> lk(_m);
+        _start.wait(lk, [&]() -> bool { return _stop || _generation != seen; });
+        if (_stop)
+            return;
+        seen              = _generation;
+        const Task& task  = *_task;
+        const size_t n    = _n;
+        const size_t team = size();
+        lk.unlock();
+        try
+        {
+            for (size_t i = (id * n + team - 1) / team; i < ((id + 1) * n + team - 1) / team; ++i)
+                task(i);
+        }
+        catch (...)
+        {
+            lock_guard<mutex> err_lk(_m);
+            if (!_error)
+                _error = current_exception();
+        }
+        lk.lock();
+        if (--_remaining == 0)
+            _done.notify_all();
+    }
+}
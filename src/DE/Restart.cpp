@@ -0,0 +1,124 @@
+#include "DE/Restart.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+using namespace std;
+namespace
+{
+pair<double, double> key_of(const Evaluated& e)
+{
+    return make_pair(accumulate(e.second.begin(), e.second.end(), 0.0), e.first);
+}
+}
+RestartController::RestartController(DE& de, const RestartConfig& conf) : _de(de), _conf(conf), _evaluations(0)
+{
+    if (conf.growth < 1)
+        throw ConfigError("restart_growth should be at least 1");
+    if (conf.stall == 0)
+        throw ConfigError("restart_stall should be positive");
+}
+RestartController::RestartController(DE& de) : RestartController(de, de.config().restart)
+{
+}
+Solution RestartController::solver()
+{
+    const GenerationCallback user_cb = _de.generation_callback();
+    const bool seeded                = _de.seeded();
+    const uint64_t seed              = _de.seed();
+    const size_t max_iter            = _de.config().max_iter;
+    const size_t start_evals         = _de.scheduler().evaluations();
+    size_t np                        = _de.np();
+    bool user_stop                   = false;
+    _runs.clear();
+    _best.clear();
+    _best_result = Evaluated(numeric_limits<double>::infinity(),
+                             ConstraintViolation{numeric_limits<double>::infinity()});
+    for (size_t r = 0; r <= _conf.max_restarts && !user_stop; ++r)
+    {
+        const size_t spent = _de.scheduler().evaluations() - start_evals;
+        if (!_budget_left(spent) || (_conf.budget != 0 && _conf.budget - spent < np))
+            break; // not even the initial population fits
+        size_t iters = max_iter;
+        if (_conf.budget != 0)
+            iters = max<size_t>(1, min(iters, (_conf.budget - spent) / np));
+        _de.reinitialize(np, iters);
+        if (seeded)
+            _de.set_seed(seed + r); // a different initial population per restart, reproducible from the seed
+
+        RestartRun run;
+        run.np                   = np;
+        const size_t run_start   = _de.scheduler().evaluations();
+        pair<double, double> top; // best of this run
+        size_t stall             = 0;
+        _de.set_generation_callback([&](const DE& de) -> bool {
+            if (user_cb && !user_cb(de))
+            {
+                user_stop = true;
+                return false;
+            }
+            const vector<Evaluated>& ys   = de.evaluated();
+            const pair<double, double> cur = key_of(ys[de.find_best()]);
+            const double scale             = _conf.tol * max(1.0, fabs(top.second));
+            if (de.curr_gen() == 1 || cur.first < top.first ||
+                (cur.first == top.first && cur.second < top.second - scale))
+                stall = 0;
+            else
+                ++stall;
+            top = de.curr_gen() == 1 ? cur : min(top, cur);
+            // a feasible population whose FOMs all agree has converged
+            double lo = numeric_limits<double>::infinity(), hi = -lo;
+            bool feasible = true;
+            for (const auto& y : ys)
+            {
+                feasible = feasible && key_of(y).first == 0;
+                lo       = min(lo, y.first);
+                hi       = max(hi, y.first);
+            }
+            run.stagnated = stall >= _conf.stall || (feasible && hi - lo <= _conf.tol * max(1.0, fabs(lo)));
+            return !run.stagnated && _budget_left(de.scheduler().evaluations() - start_evals);
+        });
+        try
+        {
+            _de.solver();
+        }
+        catch (...)
+        {
+            _de.set_generation_callback(user_cb);
+            throw;
+        }
+        const size_t best_idx = _de.find_best();
+        run.best_result       = _de.evaluated()[best_idx];
+        run.generations       = _de.curr_gen();
+        run.evaluations       = _de.scheduler().evaluations() - run_start;
+        _runs.push_back(run);
+        if (_best.empty() || key_of(run.best_result) < key_of(_best_result))
+        {
+            _best        = _de.population()[best_idx];
+            _best_result = run.best_result;
+        }
+        size_t next = static_cast<size_t>(ceil(static_cast<double>(np) * _conf.growth));
+        if (_conf.max_np != 0)
+            next = min(next, _conf.max_np);
+        np = next;
+    }
+    _de.set_generation_callback(user_cb);
+    if (seeded)
+        _de.set_seed(seed);
+    _evaluations = _de.scheduler().evaluations() - start_evals;
+    return _best;
+}
+void RestartController::report(ostream& os) const
+{
+    os << "Restarts: " << (_runs.empty() ? 0 : _runs.size() - 1) << ", evaluations: " << _evaluations;
+    if (_conf.budget != 0)
+        os << "/" << _conf.budget;
+    os << ", best FOM: " << _best_result.first << ", violation: " << key_of(_best_result).first << endl;
+    for (size_t r = 0; r < _runs.size(); ++r)
+    {
+        const RestartRun& run = _runs[r];
+        os << "    run " << r << ": NP " << run.np << ", generations " << run.generations << ", evaluations "
+           << run.evaluations << ", best FOM " << run.best_result.first << ", violation "
+           << key_of(run.best_result).first << (run.stagnated ? ", stagnated" : "") << endl;
+    }
+}
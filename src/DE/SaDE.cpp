@@ -8,31 +8,64 @@
 #include <random>
 #include <cassert>
 #include <algorithm>
+#include <numeric>
 using namespace std;
-SaDE::SaDE(Objective f, const Ranges& r, size_t np, size_t max_iter,
-           SelectionStrategy ss, unordered_map<string, double> extra)
-    : DE(f, r, nullptr, nullptr, nullptr, 0, 0, np, max_iter, extra),
+namespace
+{
+DEConfig sade_config(DEConfig conf)
+{
+    conf.variant = SelfAdaptive;
+    return conf;
+}
+DEConfig sade_config(const unordered_map<string, double>& extra, size_t np, size_t max_iter, SelectionStrategy ss)
+{
+    DEConfig conf = DEConfig::from_map(extra);
+    conf.np       = np;
+    conf.max_iter = max_iter;
+    conf.ss       = ss;
+    return sade_config(conf);
+}
+}
+SaDE::SaDE(Objective f, const Ranges& r, const DEConfig& conf)
+    : DE(f, r, sade_config(conf), nullptr, nullptr, nullptr),
       _strategy_pool(_init_strategy()), 
       _strategy_prob(_init_strategy_prob()), 
       _mem_success(deque<vector<size_t>>{}), 
       _mem_failure(deque<vector<size_t>>{}), 
       _crmemory(vector<deque<vector<double>>>(_strategy_pool.size()))
 {
-    vector<string> names{"lp", "fmu", "fsigma", "crmu", "crsigma"};
-    for(auto n : names)
-    {
-        if(extra.find(n) == extra.end())
-        {
-            cerr << "Can't find " << n << " in extra conf" << endl;
-            exit(EXIT_FAILURE);
-        }
-    }
-    _fmu      = extra.find("fmu")->second;
-    _fsigma   = extra.find("fsigma")->second;
-    _crmu     = extra.find("crmu")->second;
-    _crsigma  = extra.find("crsigma")->second;
-    _lp       = static_cast<size_t>(extra.find("lp")->second);
-    _selector = set_selector(ss, extra);
+    _fmu      = _conf.sade.fmu;
+    _fsigma   = _conf.sade.fsigma;
+    _crmu     = _conf.sade.crmu;
+    _crsigma  = _conf.sade.crsigma;
+    _lp       = _conf.sade.lp;
+    _selector = set_selector(_conf.ss, _conf);
+}
+SaDE::SaDE(Objective f, const Ranges& r, size_t np, size_t max_iter,
+           SelectionStrategy ss, unordered_map<string, double> extra)
+    : SaDE(f, r, sade_config(extra, np, max_iter, ss))
+{
+}
+void SaDE::reinitialize(size_t np, size_t max_iter)
+{
+    DE::reinitialize(np, max_iter);
+    _strategy_prob = _init_strategy_prob();
+    _mem_success.clear();
+    _mem_failure.clear();
+    _crmemory.assign(_strategy_pool.size(), deque<vector<double>>());
+}
+void SaDE::init()
+{
+    DE::init();
+    const size_t num_strategy = _strategy_pool.size();
+    _s_vec.resize(_np);
+    _cr_vec.resize(_np);
+    _crmu_vec.resize(num_strategy);
+    _success_r.resize(num_strategy);
+    _failure_r.resize(num_strategy);
+    _num_success.resize(num_strategy);
+    _num_failure.resize(num_strategy);
+    _success_rate.resize(num_strategy);
 }
 double SaDE::f() const noexcept
 {
@@ -65,32 +98,44 @@ void SaDE::_update_memory_prob(const std::vector<size_t>& strategy_vec,
                                const std::vector<Evaluated>& new_result) noexcept
 {
     // gen new records
-    vector<size_t> success_r(_strategy_pool.size(), 0);
-    vector<size_t> failure_r(_strategy_pool.size(), 0);
+    vector<size_t>& success_r = _success_r;
+    vector<size_t>& failure_r = _failure_r;
+    fill(success_r.begin(), success_r.end(), 0);
+    fill(failure_r.begin(), failure_r.end(), 0);
     assert(old_result.size() == strategy_vec.size() && strategy_vec.size() == new_result.size());
     assert(_mem_success.size() == _mem_failure.size());
     for (size_t i = 0; i < strategy_vec.size(); ++i)
     {
+        if (!_kept[i])
+            continue; // not promoted to high fidelity, the trial is a copy of its target
         const size_t s_idx = strategy_vec[i];
         if (_selector->better(new_result[i], old_result[i]))
             ++success_r[s_idx];
         else
             ++failure_r[s_idx];
     }
-    // update memory
-    if (accumulate(success_r.begin(), success_r.end(), 0) != 0)
+    // update memory, once it is full the oldest records are recycled
+    if (accumulate(success_r.begin(), success_r.end(), 0) == 0)
+        return;
+    if (_mem_success.size() < _lp)
     {
         _mem_success.push_back(success_r);
         _mem_failure.push_back(failure_r);
     }
-    if (_mem_success.size() > _lp)
+    else
     {
+        _mem_success.push_back(move(_mem_success.front()));
+        _mem_failure.push_back(move(_mem_failure.front()));
         _mem_success.pop_front();
         _mem_failure.pop_front();
+        _mem_success.back() = success_r;
+        _mem_failure.back() = failure_r;
         // update probablities
         const double epsilon = 0.01;  // to avoid null probablities
-        vector<size_t> num_success(_strategy_pool.size(), 0);
-        vector<size_t> num_failure(_strategy_pool.size(), 0);
+        vector<size_t>& num_success = _num_success;
+        vector<size_t>& num_failure = _num_failure;
+        fill(num_success.begin(), num_success.end(), 0);
+        fill(num_failure.begin(), num_failure.end(), 0);
         assert(_mem_success.size() == _lp && _lp == _mem_failure.size());
         for(size_t i = 0; i < _lp; ++i)
         {
@@ -103,7 +148,8 @@ void SaDE::_update_memory_prob(const std::vector<size_t>& strategy_vec,
                 num_failure[j] += rf[j];
             }
         }
-        vector<double> success_rate(_strategy_pool.size(), epsilon);
+        vector<double>& success_rate = _success_rate;
+        fill(success_rate.begin(), success_rate.end(), epsilon);
         for (size_t i = 0; i < success_rate.size(); ++i)
         {
             if (num_success[i] + num_failure[i] > 0)
@@ -121,28 +167,25 @@ void SaDE::_update_memory_prob(const std::vector<size_t>& strategy_vec,
 }
 size_t SaDE::_select_strategy(const vector<double>& probs) const noexcept
 {
-    const double sum = accumulate(probs.begin(), probs.end(), 0.0);
-    assert(fabs(sum - 1) < 0.01);  // probablities sum up to 1
-    vector<pair<double, double>> ranges(probs.size(), {0, 0});
-    for (size_t i = 0; i < probs.size(); ++i)
-    {
-        ranges[i].first  = i == 0 ? 0 : ranges[i - 1].second;
-        ranges[i].second = i == 0 ? probs[i] : ranges[i].first + probs[i];
-    }
+    assert(fabs(accumulate(probs.begin(), probs.end(), 0.0) - 1) < 0.01);  // probablities sum up to 1
     const double rand01 = uniform_real_distribution<double>(0, 1)(engine);
-    size_t sampled = ranges.size();
-    for (size_t i = 0; i < ranges.size(); ++i)
+    // strategy i owns [lower, upper), the bounds accumulated along the probabilities
+    size_t sampled = probs.size();
+    double lower   = 0;
+    for (size_t i = 0; i < probs.size(); ++i)
     {
-        if (ranges[i].first <= rand01 && rand01 < ranges[i].second)
+        const double upper = i == 0 ? probs[i] : lower + probs[i];
+        if (lower <= rand01 && rand01 < upper)
         {
             sampled = i;
             break;
         }
+        lower = upper;
     }
-    assert(sampled < ranges.size());
+    assert(sampled < probs.size());
     return sampled;
 }
-vector<double> SaDE::gen_cr_vec(const std::vector<size_t>& s_vec) const noexcept
+void SaDE::gen_cr_vec(const std::vector<size_t>& s_vec, std::vector<double>& cr_vec) noexcept
 {
     auto random_func = [&](const double mu, const double sigma, const double lb, const double ub)->double{
         double tmp = lb - 1;
@@ -152,7 +195,7 @@ vector<double> SaDE::gen_cr_vec(const std::vector<size_t>& s_vec) const noexcept
         }
         return tmp;
     };
-    vector<double> cr_vec(_np, 0);
+    assert(cr_vec.size() == _np);
     if (_curr_gen <= _lp)
     {
         for (size_t i = 0; i < _np; ++i)
@@ -162,10 +205,11 @@ vector<double> SaDE::gen_cr_vec(const std::vector<size_t>& s_vec) const noexcept
     }
     else
     {
-        vector<double> crmu_vec(_strategy_pool.size(), 0);
+        vector<double>& crmu_vec = _crmu_vec;
         for (size_t i = 0; i < crmu_vec.size(); ++i)
         {
-            vector<double> container;
+            vector<double>& container = _cr_pool;
+            container.clear();
             const auto& memory = _crmemory[i];
             assert(memory.size() == _lp);
             for (const auto& vec : memory)
@@ -193,7 +237,6 @@ vector<double> SaDE::gen_cr_vec(const std::vector<size_t>& s_vec) const noexcept
             cr_vec[i] = random_func(crmu_vec[s_vec[i]], _crsigma, 0, 1);
         }
     }
-    return cr_vec;
 }
 void SaDE::_update_cr_memory(const vector<size_t>& s_vec, const vector<double>& cr_vec,
                              const vector<Evaluated>& old_result,
@@ -205,60 +248,72 @@ void SaDE::_update_cr_memory(const vector<size_t>& s_vec, const vector<double>&
     assert(_crmemory.size() == _strategy_pool.size());
     for (size_t i = 0; i < _strategy_pool.size(); ++i)
     {
-        _crmemory[i].push_back(vector<double>{});
+        auto& memory = _crmemory[i];
         if (_curr_gen > _lp)
         {
-            _crmemory[i].pop_front();
-            assert(_crmemory[i].size() == _lp);
+            // the oldest generation is recycled, keeping its capacity
+            memory.push_back(move(memory.front()));
+            memory.pop_front();
+            memory.back().clear();
+            assert(memory.size() == _lp);
         }
+        else
+            memory.push_back(vector<double>{});
     }
     for (size_t i = 0; i < cr_vec.size(); ++i)
     {
         const size_t s_idx = s_vec[i];
-        if (_selector->better(new_result[i], old_result[i]))
+        if (_kept[i] && _selector->better(new_result[i], old_result[i]))
         {
             _crmemory[s_idx][_crmemory[s_idx].size() - 1].push_back(cr_vec[i]);
         }
     }
 }
-Solution SaDE::solver()
+Solution SaDE::evolve()
 {
-    init();
-    for (_curr_gen = 1; _curr_gen < _max_iter; ++_curr_gen)
+    _stopped = false;
+    for (; _curr_gen < _max_iter; ++_curr_gen)
     {
-        vector<Solution> trials;
-        vector<size_t> s_vec;
-        trials.reserve(_np);
-        s_vec.reserve(_np);
-        for (size_t i = 0; i < _np; ++i)
+        vector<size_t>& s_vec = _s_vec;
+        vector<double>& cr_vec = _cr_vec;
         {
-            s_vec.push_back(_select_strategy(_strategy_prob));
+            PhaseTimer t(_metrics, PhaseVariation);
+            for (size_t i = 0; i < _np; ++i)
+            {
+                s_vec[i] = _select_strategy(_strategy_prob);
+            }
+            gen_cr_vec(s_vec, cr_vec);
+            for (size_t i = 0; i < _np; ++i)
+            {
+                const Strategy& s = _strategy_pool[s_vec[i]];
+                s.mutator->mutate_into(*this, i, _doners[i]);
+                _curr_cr = cr_vec[i];
+                s.crossover->crossover_into(*this, _population[i], _doners[i], _trials[i]);
+            }
         }
-        vector<double> cr_vec = gen_cr_vec(s_vec);
-        assert(cr_vec.size() == _np);
-        for (size_t i = 0; i < _np; ++i)
         {
-            const Strategy& s = _strategy_pool[s_vec[i]];
-            const Solution& target = _population[i];
-            const Solution doner = s.mutator->mutation_solution(*this, i);
-            _curr_cr = cr_vec[i];
-            trials.push_back(s.crossover->crossover_solution(*this, target, doner));
+            PhaseTimer t(_metrics, PhaseEvaluation);
+            evaluate_trials(_trials, _trial_results, _all);
         }
-        vector<Evaluated> trial_results(_np);
-#pragma omp parallel for
-        // OpenMP 2.0 doesn't allow unsigned for loop index!
-        // But it seems VS2015 is still using this version
-        for (int p_idx = 0; p_idx < static_cast<int>(_population.size()); ++p_idx)
         {
-            trial_results[p_idx] = _func(p_idx, trials[p_idx]);
+            PhaseTimer t(_metrics, PhaseRepair);
+            repair(_trials, _trial_results);
         }
-        _update_memory_prob(s_vec, _results, trial_results);
-        _update_cr_memory(s_vec, cr_vec, _results, trial_results);
-        auto new_result = _selector->select(*this, _population, trials, _results, trial_results);
-        _results = new_result.first;
-        _population = new_result.second;
-        report_best();
+        {
+            PhaseTimer t(_metrics, PhaseSelection);
+            _update_memory_prob(s_vec, _results, _trial_results);
+            _update_cr_memory(s_vec, cr_vec, _results, _trial_results);
+            _selector->select_inplace(*this, _population, _results, _trials, _trial_results);
+        }
+        if (!end_generation())
+            break;
     }
+    _metrics.set_running(false);
     size_t best_idx = find_best();
     return _population[best_idx];
 }
+void SaDE::update_metrics() noexcept
+{
+    DE::update_metrics();
+    _metrics.set_strategy_probabilities(_strategy_prob);
+}
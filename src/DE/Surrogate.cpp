@@ -0,0 +1,190 @@
+#include "DE/Surrogate.h"
+#include "DE/DEOrigin.h"
+#include "global.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cassert>
+#include <cmath>
+using namespace std;
+void KDTree::build(const vector<Solution>& points)
+{
+    _points = &points;
+    _nodes.clear();
+    _nodes.reserve(points.size());
+    vector<size_t> idx(points.size());
+    iota(idx.begin(), idx.end(), 0);
+    _root = _build(idx, 0, idx.size(), 0);
+}
+size_t KDTree::_build(vector<size_t>& idx, size_t lo, size_t hi, size_t depth)
+{
+    if (lo >= hi)
+        return nil;
+    const vector<Solution>& pts = *_points;
+    const size_t axis = depth % pts[idx[lo]].size();
+    const size_t mid  = lo + (hi - lo) / 2;
+    nth_element(idx.begin() + lo, idx.begin() + mid, idx.begin() + hi,
+                [&](size_t a, size_t b) -> bool { return pts[a][axis] < pts[b][axis]; });
+    const size_t node = _nodes.size();
+    _nodes.push_back(Node{idx[mid], axis, nil, nil});
+    const size_t left  = _build(idx, lo, mid, depth + 1);
+    const size_t right = _build(idx, mid + 1, hi, depth + 1);
+    _nodes[node].left  = left;
+    _nodes[node].right = right;
+    return node;
+}
+void KDTree::knn(const Solution& query, size_t k, vector<pair<double, size_t>>& out) const
+{
+    out.clear();
+    if (_root != nil && k > 0)
+        _search(_root, query, k, out);
+    sort_heap(out.begin(), out.end());
+}
+void KDTree::_search(size_t node, const Solution& q, size_t k, vector<pair<double, size_t>>& heap) const
+{
+    const Node& n     = _nodes[node];
+    const Solution& p = (*_points)[n.point];
+    double dist2      = 0;
+    for (size_t i = 0; i < q.size(); ++i)
+    {
+        const double d = static_cast<double>(q[i]) - static_cast<double>(p[i]);
+        dist2 += d * d;
+    }
+    if (heap.size() < k)
+    {
+        heap.emplace_back(dist2, n.point);
+        push_heap(heap.begin(), heap.end());
+    }
+    else if (dist2 < heap.front().first)
+    {
+        pop_heap(heap.begin(), heap.end());
+        heap.back() = make_pair(dist2, n.point);
+        push_heap(heap.begin(), heap.end());
+    }
+    const double diff = static_cast<double>(q[n.axis]) - static_cast<double>(p[n.axis]);
+    const size_t near = diff < 0 ? n.left : n.right;
+    const size_t far  = diff < 0 ? n.right : n.left;
+    if (near != nil)
+        _search(near, q, k, heap);
+    if (far != nil && (heap.size() < k || diff * diff < heap.front().first))
+        _search(far, q, k, heap);
+}
+
+void Surrogate_KNN::fit(const vector<Solution>& xs, const vector<Evaluated>& ys)
+{
+    assert(xs.size() == ys.size());
+    _tree.build(xs);
+    _ys = &ys;
+}
+Evaluated Surrogate_KNN::predict(const Solution& x) const
+{
+    vector<pair<double, size_t>> neighbours;
+    _tree.knn(x, _k, neighbours);
+    assert(!neighbours.empty());
+    double wsum = 0, fom = 0, violation = 0;
+    for (const auto& nb : neighbours)
+    {
+        const Evaluated& y = (*_ys)[nb.second];
+        const double vio   = accumulate(y.second.begin(), y.second.end(), 0.0);
+        if (nb.first == 0) // exact match
+            return Evaluated(y.first, ConstraintViolation{vio});
+        const double w = 1.0 / nb.first;
+        wsum += w;
+        fom += w * y.first;
+        violation += w * vio;
+    }
+    return Evaluated(fom / wsum, ConstraintViolation{violation / wsum});
+}
+
+double SurrogateStats::accuracy() const noexcept
+{
+    const size_t evaluated = predicted_win + explored;
+    const size_t correct   = true_win + (explored - explored_win);
+    return evaluated == 0 ? 0 : static_cast<double>(correct) / static_cast<double>(evaluated);
+}
+double SurrogateStats::precision() const noexcept
+{
+    return predicted_win == 0 ? 0 : static_cast<double>(true_win) / static_cast<double>(predicted_win);
+}
+
+SurrogateScreen::SurrogateScreen(ISurrogate* model, double explore, size_t min_archive, size_t max_archive)
+    : _model(model), _explore(explore), _min_archive(min_archive), _max_archive(max_archive), _oldest(0)
+{
+    if (explore < 0 || explore > 1)
+        throw ConfigError("surrogate_explore should be in [0, 1]");
+}
+SurrogateScreen::~SurrogateScreen()
+{
+    delete _model;
+}
+Solution SurrogateScreen::_normalize(const DE& de, const Solution& x) const
+{
+    Solution normalized(x.size());
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        const auto rg = de.range(i);
+        normalized[i] = rg.second > rg.first ? (x[i] - rg.first) / (rg.second - rg.first) : 0;
+    }
+    return normalized;
+}
+void SurrogateScreen::add(const DE& de, const Solution& x, const Evaluated& y)
+{
+    const auto inf_pred = [](double v) -> bool { return std::isinf(v) || std::isnan(v); };
+    if (inf_pred(y.first) || any_of(y.second.begin(), y.second.end(), inf_pred))
+        return;
+    if (_max_archive == 0 || _xs.size() < _max_archive)
+    {
+        _xs.push_back(_normalize(de, x));
+        _ys.push_back(y);
+    }
+    else
+    {
+        _xs[_oldest] = _normalize(de, x);
+        _ys[_oldest] = y;
+        _oldest      = (_oldest + 1) % _max_archive;
+    }
+}
+vector<size_t> SurrogateScreen::screen(const DE& de, ISelector& selector, const vector<Solution>& trials,
+                                       const vector<Evaluated>& target_results)
+{
+    assert(ready());
+    _model->fit(_xs, _ys);
+    uniform_real_distribution<double> distr(0, 1);
+    vector<size_t> to_evaluate;
+    _predicted_win.assign(trials.size(), 0);
+    for (size_t i = 0; i < trials.size(); ++i)
+    {
+        const Evaluated predicted = _model->predict(_normalize(de, trials[i]));
+        _predicted_win[i]         = selector.better(predicted, target_results[i]);
+        ++_stats.screened;
+        if (_predicted_win[i] || distr(engine) < _explore)
+            to_evaluate.push_back(i);
+        else
+            ++_stats.skipped;
+    }
+    return to_evaluate;
+}
+void SurrogateScreen::record(ISelector& selector, const vector<size_t>& evaluated,
+                             const vector<Evaluated>& trial_results, const vector<Evaluated>& target_results)
+{
+    for (size_t i : evaluated)
+    {
+        const bool win = selector.better(trial_results[i], target_results[i]);
+        if (_predicted_win[i])
+        {
+            ++_stats.predicted_win;
+            _stats.true_win += win ? 1 : 0;
+        }
+        else
+        {
+            ++_stats.explored;
+            _stats.explored_win += win ? 1 : 0;
+        }
+    }
+}
+void SurrogateScreen::report(ostream& os) const
+{
+    os << "Surrogate screened: " << _stats.screened << ", evaluations saved: " << _stats.skipped
+       << ", accuracy: " << _stats.accuracy() << ", precision: " << _stats.precision()
+       << ", missed winners among explored: " << _stats.explored_win << "/" << _stats.explored << endl;
+}
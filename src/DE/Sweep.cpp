@@ -0,0 +1,242 @@
+#include "DE/Sweep.h"
+#include "DE/DERandomF.h"
+#include "DE/SaDE.h"
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <chrono>
+#include <iomanip>
+#include <cassert>
+using namespace std;
+namespace
+{
+template <typename Enum>
+string lut_name(const unordered_map<string, Enum>& lut, Enum val)
+{
+    for (const auto& kv : lut)
+        if (kv.second == val)
+            return kv.first;
+    return "?";
+}
+// splitmix64 finalizer, decorrelates the seeds of neighbouring configs
+uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+double total_violation(const Evaluated& e)
+{
+    return accumulate(e.second.begin(), e.second.end(), 0.0);
+}
+}
+Sweep::Sweep(Objective func, const Ranges& rg)
+    : _func(func), _ranges(rg), _stop_min_gen(0), _stop_quantile(0.75), _stop_min_peers(4), _ranking_set(false),
+      _ranking(FeasibilityRule)
+{
+}
+vector<SweepConfig> Sweep::grid(const SweepConfig& base, const vector<MutationStrategy>& mss,
+                                const vector<CrossoverStrategy>& css, const vector<double>& fs,
+                                const vector<double>& crs, const vector<uint64_t>& seeds)
+{
+    vector<SweepConfig> configs;
+    for (auto ms : mss)
+        for (auto cs : css)
+            for (double f : fs)
+                for (double cr : crs)
+                    for (uint64_t seed : seeds)
+                    {
+                        SweepConfig c = base;
+                        c.ms          = ms;
+                        c.cs          = cs;
+                        c.f           = f;
+                        c.cr          = cr;
+                        c.seed        = seed;
+                        c.name = lut_name(ms_lut, ms) + "/" + lut_name(cs_lut, cs) + "/F=" + to_string(f) +
+                                 "/CR=" + to_string(cr) + "/seed=" + to_string(seed);
+                        configs.push_back(c);
+                    }
+    return configs;
+}
+void Sweep::set_early_stop(size_t min_gen, double quantile, size_t min_peers)
+{
+    if (quantile <= 0 || quantile > 1)
+        throw ConfigError("early stop quantile should be in (0, 1]");
+    _stop_min_gen   = min_gen;
+    _stop_quantile  = quantile;
+    _stop_min_peers = min_peers;
+}
+void Sweep::set_ranking(SelectionStrategy ss)
+{
+    _ranking_set = true;
+    _ranking     = ss;
+}
+const vector<SweepResult>& Sweep::run()
+{
+    SelectionStrategy ss = _ranking;
+    if (!_ranking_set && !_configs.empty())
+    {
+        ss = _configs[0].ss;
+        for (const auto& c : _configs)
+            if (c.ss != ss)
+                ss = FeasibilityRule;
+    }
+    if (ss == StaticPenalty)
+        _selector.reset(new Selector_StaticPenalty);
+    else if (ss == FeasibilityRule || ss == Epsilon)
+        _selector.reset(new Selector_FeasibilityRule);
+    else
+        throw ConfigError("Unrecognized Selection Strategy");
+    _results.assign(_configs.size(), SweepResult());
+    _runs.clear();
+    _runs.resize(_configs.size());
+    if (_stop_min_gen == 0)
+    {
+        ThreadPool::instance().run(_configs.size(), [&](size_t i) { _run_one(i, 0); });
+        return _results;
+    }
+    _at_checkpoint.assign(_configs.size(), 0);
+    _checkpoint_bests.assign(_configs.size(), Evaluated());
+    ThreadPool::instance().run(_configs.size(), [&](size_t i) { _run_one(i, _stop_min_gen); });
+    const vector<char> hopeless = _hopeless();
+    vector<size_t> survivors;
+    for (size_t i = 0; i < _configs.size(); ++i)
+    {
+        if (hopeless[i])
+            _results[i].stopped_early = true;
+        if (_at_checkpoint[i] && !hopeless[i])
+            survivors.push_back(i);
+        else
+            _runs[i].reset();
+    }
+    ThreadPool::instance().run(survivors, [&](size_t i) { _resume_one(i); });
+    return _results;
+}
+bool Sweep::_ahead(const Evaluated& a, const Evaluated& b) const
+{
+    return _selector->better(a, b) && !_selector->better(b, a);
+}
+vector<char> Sweep::_hopeless() const
+{
+    vector<char> hopeless(_configs.size(), 0);
+    vector<Evaluated> peers;
+    for (size_t i = 0; i < _configs.size(); ++i)
+        if (_at_checkpoint[i])
+            peers.push_back(_checkpoint_bests[i]);
+    if (peers.empty() || peers.size() < _stop_min_peers)
+        return hopeless;
+    const size_t cutoff = min(peers.size() - 1, static_cast<size_t>(_stop_quantile * peers.size()));
+    nth_element(peers.begin(), peers.begin() + cutoff, peers.end(),
+                [&](const Evaluated& a, const Evaluated& b) { return _ahead(a, b); });
+    for (size_t i = 0; i < _configs.size(); ++i)
+        hopeless[i] = _at_checkpoint[i] && _ahead(peers[cutoff], _checkpoint_bests[i]);
+    return hopeless;
+}
+void Sweep::_run_one(size_t idx, size_t stop_gen)
+{
+    const SweepConfig& c = _configs[idx];
+    SweepResult& r       = _results[idx];
+    r                    = SweepResult();
+    r.config             = c;
+    unordered_map<string, double> extra(c.extra);
+    if (extra.find("eval_schedule") == extra.end())
+        extra["eval_schedule"] = WorkStealing; // interleave with the other runs on the shared pool
+    unique_ptr<DE>& de = _runs[idx];
+    switch (c.variant)
+    {
+        case Origin:
+            de.reset(new DE(_func, _ranges, c.ms, c.cs, c.ss, c.f, c.cr, c.np, c.max_iter, extra));
+            break;
+        case RandomF:
+            de.reset(new DERandomF(_func, _ranges, c.ms, c.cs, c.ss, c.f, c.cr, c.np, c.max_iter, extra));
+            break;
+        case SelfAdaptive:
+            de.reset(new SaDE(_func, _ranges, c.np, c.max_iter, c.ss, extra));
+            break;
+        default:
+            throw ConfigError("Unrecognized DE variant");
+    }
+    de->set_log(nullptr);
+    de->set_seed(mix(c.seed ^ mix(idx)));
+    de->set_generation_callback([this, idx, stop_gen](const DE& d) -> bool {
+        SweepResult& r        = _results[idx];
+        const Evaluated& best = d.evaluated()[d.find_best()];
+        r.curve.push_back(best.first);
+        r.violation_curve.push_back(total_violation(best));
+        if (stop_gen == 0 || d.curr_gen() < stop_gen)
+            return true;
+        _at_checkpoint[idx]    = 1;
+        _checkpoint_bests[idx] = best;
+        return false;
+    });
+    _finish(idx, [&]() { return de->solver(); });
+    if (stop_gen == 0 || !_at_checkpoint[idx])
+        _runs[idx].reset(); // finished
+}
+void Sweep::_resume_one(size_t idx)
+{
+    DE& de = *_runs[idx];
+    de.set_generation_callback([this, idx](const DE& d) -> bool {
+        const Evaluated& best = d.evaluated()[d.find_best()];
+        _results[idx].curve.push_back(best.first);
+        _results[idx].violation_curve.push_back(total_violation(best));
+        return true;
+    });
+    _finish(idx, [&]() { return de.resume(); });
+    _runs[idx].reset();
+}
+void Sweep::_finish(size_t idx, const function<Solution()>& solve)
+{
+    SweepResult& r = _results[idx];
+    const DE& de   = *_runs[idx];
+    const auto t0  = chrono::steady_clock::now();
+    r.best         = solve();
+    // both passes of a resumed run, the evaluations are counted by the same scheduler
+    r.seconds     += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    r.best_result  = de.evaluated()[de.find_best()];
+    r.generations  = r.curve.size() + 1;
+    r.evaluations  = de.scheduler().evaluations();
+}
+void Sweep::summary(ostream& os) const
+{
+    vector<size_t> order(_results.size());
+    iota(order.begin(), order.end(), 0);
+    if (_selector)
+        stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) -> bool {
+            return _ahead(_results[i].best_result, _results[j].best_result);
+        });
+    os << left << setw(40) << "name" << setw(9) << "variant" << setw(18) << "selection" << setw(6) << "NP"
+       << setw(7) << "gens" << setw(10) << "evals" << setw(14) << "best FOM" << setw(14) << "violation"
+       << setw(10) << "seconds" << "stopped" << endl;
+    for (size_t i : order)
+    {
+        const SweepResult& r = _results[i];
+        os << left << setw(40) << r.config.name << setw(9) << lut_name(dv_lut, r.config.variant) << setw(18)
+           << lut_name(ss_lut, r.config.ss) << setw(6) << r.config.np << setw(7) << r.generations << setw(10)
+           << r.evaluations << setw(14) << r.best_result.first << setw(14) << total_violation(r.best_result)
+           << setw(10) << r.seconds << (r.stopped_early ? "yes" : "no") << endl;
+    }
+}
+void Sweep::curves(ostream& os) const
+{
+    size_t max_gen = 0;
+    os << "gen";
+    for (const auto& r : _results)
+    {
+        os << "," << r.config.name;
+        max_gen = max(max_gen, r.curve.size());
+    }
+    os << endl;
+    for (size_t g = 0; g < max_gen; ++g)
+    {
+        os << g + 1;
+        for (const auto& r : _results)
+        {
+            os << ",";
+            if (g < r.curve.size())
+                os << r.curve[g];
+        }
+        os << endl;
+    }
+}
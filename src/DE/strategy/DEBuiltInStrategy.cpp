@@ -5,162 +5,226 @@
 #include <algorithm>
 #include <numeric>
 #include <cassert>
+#include <cmath>
+#include <limits>
 using namespace std;
-Solution Mutator_Rand_1::mutation_solution(const DE& de, size_t curr_idx)
+namespace
+{
+// body(j, i) for the j-th coordinate i, index[j] or j itself when index is null
+template <typename Body>
+void for_coords(const size_t* index, size_t n, Body body)
+{
+    if (index == nullptr)
+        for (size_t j = 0; j < n; ++j)
+            body(j, j);
+    else
+        for (size_t j = 0; j < n; ++j)
+            body(j, index[j]);
+}
+}
+Solution BuiltInMutator::mutation_solution(const DE& de, size_t curr_idx)
+{
+    Solution mutated(de.dimension());
+    mutate_into(de, curr_idx, mutated);
+    return mutated;
+}
+void BuiltInMutator::mutate_into(const DE& de, size_t curr_idx, Solution& mutated)
+{
+    // `mutated` is never a row of the population, resizing it is a no-op for the rows of the arena
+    mutated.resize(de.dimension());
+    _mutate(de, curr_idx, nullptr, mutated.size(), mutated.data());
+}
+void BuiltInMutator::mutate_at(const DE& de, size_t curr_idx, const vector<size_t>& index, Solution& value)
+{
+    value.resize(index.size());
+    _mutate(de, curr_idx, index.data(), index.size(), value.data());
+}
+void BuiltInMutator::mutate_all(const DE& de, vector<Solution>& out)
+{
+    for (size_t i = 0; i < out.size(); ++i)
+        mutate_into(de, i, out[i]);
+}
+Solution BuiltInCrossover::crossover_solution(const DE& de, const Solution& target, const Solution& doner)
+{
+    Solution trial(de.dimension());
+    crossover_into(de, target, doner, trial);
+    return trial;
+}
+void BuiltInCrossover::crossover_all(const DE& de, const vector<Solution>& targets, const vector<Solution>& doners,
+                                     vector<Solution>& trials)
+{
+    for (size_t i = 0; i < trials.size(); ++i)
+        crossover_into(de, targets[i], doners[i], trials[i]);
+}
+// Every mutator first computes the differential vector in a plain loop the compiler can
+// vectorize, then applies the boundary constraint coordinate by coordinate, over all the
+// coordinates or only the listed ones
+void Mutator_Rand_1::_mutate(const DE& de, size_t, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    Solution mutated = population[curr_idx];
     size_t r1 = random_exclusive<size_t>(i_distr);
-    size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{r1});
-    size_t r3 = random_exclusive<size_t>(i_distr, vector<size_t>{r1, r2});
-    double f  = de.f();
-    for (size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(
-                de.range(i),
-                population[r1][i] + f * (population[r2][i] - population[r3][i]));
-    }
-    return mutated;
+    size_t r2 = random_exclusive<size_t>(i_distr, {r1});
+    size_t r3 = random_exclusive<size_t>(i_distr, {r1, r2});
+    const Scalar f = static_cast<Scalar>(de.f());
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    const Scalar* x3 = population[r3].data();
+    for_coords(index, n, [&](size_t j, size_t i) { mutated[j] = x1[i] + f * (x2[i] - x3[i]); });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_Rand_2::mutation_solution(const DE& de, size_t curr_idx)
+void Mutator_Rand_2::_mutate(const DE& de, size_t, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    Solution mutated = population[curr_idx];
     size_t r1 = random_exclusive<size_t>(i_distr);
-    size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t> {r1});
-    size_t r3 = random_exclusive<size_t>(i_distr, vector<size_t> {r1, r2});
-    size_t r4 = random_exclusive<size_t>(i_distr, vector<size_t> {r1, r2, r3});
-    size_t r5 = random_exclusive<size_t>(i_distr, vector<size_t> {r1, r2, r3, r4});
-    double f1 = de.f();
-    double f2 = de.f();
-    for (size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(
-            de.range(i), population[r1][i] + f1 * (population[r2][i] - population[r3][i]) 
-                                           + f2 * (population[r4][i] - population[r5][i]));
-    }
-    return mutated;
+    size_t r2 = random_exclusive<size_t>(i_distr, {r1});
+    size_t r3 = random_exclusive<size_t>(i_distr, {r1, r2});
+    size_t r4 = random_exclusive<size_t>(i_distr, {r1, r2, r3});
+    size_t r5 = random_exclusive<size_t>(i_distr, {r1, r2, r3, r4});
+    const Scalar f1 = static_cast<Scalar>(de.f());
+    const Scalar f2 = static_cast<Scalar>(de.f());
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    const Scalar* x3 = population[r3].data();
+    const Scalar* x4 = population[r4].data();
+    const Scalar* x5 = population[r5].data();
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = x1[i] + f1 * (x2[i] - x3[i]) + f2 * (x4[i] - x5[i]);
+    });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_Best_1::mutation_solution(const DE& de, size_t)
+void Mutator_Best_1::_mutate(const DE& de, size_t, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     const size_t best_idx       = de.find_best();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    const size_t r1 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx});
-    const size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1});
-    const double f  = de.f();
-    Solution mutated(de.dimension());
-    for (size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(
-                de.range(i), population[best_idx][i] + f * (population[r1][i] - population[r2][i]));
-    }
-    return mutated;
+    const size_t r1 = random_exclusive<size_t>(i_distr, {best_idx});
+    const size_t r2 = random_exclusive<size_t>(i_distr, {best_idx, r1});
+    const Scalar f  = static_cast<Scalar>(de.f());
+    const Scalar* xb = population[best_idx].data();
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    for_coords(index, n, [&](size_t j, size_t i) { mutated[j] = xb[i] + f * (x1[i] - x2[i]); });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_Best_2::mutation_solution(const DE& de, size_t)
+void Mutator_Best_2::_mutate(const DE& de, size_t, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     const size_t best_idx = de.find_best();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    const size_t r1 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx});
-    const size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1});
-    const size_t r3 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1, r2});
-    const size_t r4 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1, r2, r3});
-    const double f1 = de.f();
-    const double f2 = de.f();
-    Solution mutated(de.dimension());
-    for (size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(
-                de.range(i), population[best_idx][i] + f1 * (population[r1][i] - population[r2][i]) 
-                + f2 * (population[r3][i] - population[r4][i]));
-    }
-    return mutated;
+    const size_t r1 = random_exclusive<size_t>(i_distr, {best_idx});
+    const size_t r2 = random_exclusive<size_t>(i_distr, {best_idx, r1});
+    const size_t r3 = random_exclusive<size_t>(i_distr, {best_idx, r1, r2});
+    const size_t r4 = random_exclusive<size_t>(i_distr, {best_idx, r1, r2, r3});
+    const Scalar f1 = static_cast<Scalar>(de.f());
+    const Scalar f2 = static_cast<Scalar>(de.f());
+    const Scalar* xb = population[best_idx].data();
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    const Scalar* x3 = population[r3].data();
+    const Scalar* x4 = population[r4].data();
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = xb[i] + f1 * (x1[i] - x2[i]) + f2 * (x3[i] - x4[i]);
+    });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_CurrentToRand_1::mutation_solution(const DE& de, size_t curr_idx)
+void Mutator_CurrentToRand_1::_mutate(const DE& de, size_t curr_idx, const size_t* index, size_t n, Scalar* mutated)
 {
     assert(curr_idx < de.population().size());
     const vector<Solution>& population = de.population();
     uniform_int_distribution<size_t>  i_distr(0, population.size() - 1);
     uniform_real_distribution<double> k_distr(0, 1);
-    Solution mutated(population[curr_idx]);
     const size_t r1 = random_exclusive<size_t>(i_distr);
-    const size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{r1});
-    const size_t r3 = random_exclusive<size_t>(i_distr, vector<size_t>{r1, r2});
-    const double f  = de.f();
-    const double k  = k_distr(engine);
-    for (size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(
-                de.range(i), mutated[i] + k * (population[r1][i] - mutated[i]) +
-                f * (population[r2][i] - population[r3][i]));
-    }
-    return mutated;
+    const size_t r2 = random_exclusive<size_t>(i_distr, {r1});
+    const size_t r3 = random_exclusive<size_t>(i_distr, {r1, r2});
+    const Scalar f  = static_cast<Scalar>(de.f());
+    const Scalar k  = static_cast<Scalar>(k_distr(engine));
+    const Scalar* xc = population[curr_idx].data();
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    const Scalar* x3 = population[r3].data();
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = xc[i] + k * (x1[i] - xc[i]) + f * (x2[i] - x3[i]);
+    });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_RandToBest_1::mutation_solution(const DE& de, size_t curr_idx)
+void Mutator_RandToBest_1::_mutate(const DE& de, size_t curr_idx, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    Solution mutated(population[curr_idx]);
     const size_t best_idx = de.find_best();
-    const size_t r1 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx});
-    const size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1});
-    const double f1 = de.f();
-    const double f2 = de.f();
-    for(size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(de.range(i),
-                                         mutated[i] + f1 * (population[best_idx][i] - mutated[i]) 
-                                                    + f2 * (population[r1][i] - population[r2][i]));
-    }
-    return mutated;
+    const size_t r1 = random_exclusive<size_t>(i_distr, {best_idx});
+    const size_t r2 = random_exclusive<size_t>(i_distr, {best_idx, r1});
+    const Scalar f1 = static_cast<Scalar>(de.f());
+    const Scalar f2 = static_cast<Scalar>(de.f());
+    const Scalar* xc = population[curr_idx].data();
+    const Scalar* xb = population[best_idx].data();
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = xc[i] + f1 * (xb[i] - xc[i]) + f2 * (x1[i] - x2[i]);
+    });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Mutator_RandToBest_2::mutation_solution(const DE& de, size_t curr_idx)
+void Mutator_RandToBest_2::_mutate(const DE& de, size_t curr_idx, const size_t* index, size_t n, Scalar* mutated)
 {
     const vector<Solution>& population = de.population();
     uniform_int_distribution<size_t> i_distr(0, population.size() - 1);
-    Solution mutated(population[curr_idx]);
     const size_t best_idx = de.find_best();
-    const size_t r1 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx});
-    const size_t r2 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1});
-    const size_t r3 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1, r2});
-    const size_t r4 = random_exclusive<size_t>(i_distr, vector<size_t>{best_idx, r1, r2, r3});
-    const double f1 = de.f();
-    const double f2 = de.f();
-    const double f3 = de.f();
-    for(size_t i = 0; i < de.dimension(); ++i)
-    {
-        mutated[i] = boundary_constraint(de.range(i),
-                                         mutated[i] + f1 * (population[best_idx][i] - mutated[i]) 
-                                                    + f2 * (population[r1][i] - population[r2][i])
-                                                    + f3 * (population[r3][i] - population[r4][i]));
-    }
-    return mutated;
+    const size_t r1 = random_exclusive<size_t>(i_distr, {best_idx});
+    const size_t r2 = random_exclusive<size_t>(i_distr, {best_idx, r1});
+    const size_t r3 = random_exclusive<size_t>(i_distr, {best_idx, r1, r2});
+    const size_t r4 = random_exclusive<size_t>(i_distr, {best_idx, r1, r2, r3});
+    const Scalar f1 = static_cast<Scalar>(de.f());
+    const Scalar f2 = static_cast<Scalar>(de.f());
+    const Scalar f3 = static_cast<Scalar>(de.f());
+    const Scalar* xc = population[curr_idx].data();
+    const Scalar* xb = population[best_idx].data();
+    const Scalar* x1 = population[r1].data();
+    const Scalar* x2 = population[r2].data();
+    const Scalar* x3 = population[r3].data();
+    const Scalar* x4 = population[r4].data();
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = xc[i] + f1 * (xb[i] - xc[i]) + f2 * (x1[i] - x2[i]) + f3 * (x3[i] - x4[i]);
+    });
+    for_coords(index, n, [&](size_t j, size_t i) {
+        mutated[j] = boundary_constraint(de.range(i), mutated[j]);
+    });
 }
-Solution Crossover_Bin::crossover_solution(const DE& de, const Solution& target, const Solution& doner)
+void Crossover_Bin::crossover_into(const DE& de, const Solution& target, const Solution& doner, Solution& trial)
 {
     const double cr  = de.cr();
     const size_t dim = de.dimension();
     uniform_int_distribution<size_t> distr_idx(0, dim - 1);
     uniform_real_distribution<double> distr_prob(0, 1);
-    Solution trial(dim);
+    trial.resize(dim);
     const size_t rand_idx = distr_idx(engine);
     for (size_t i = 0; i < dim; ++i)
     {
         trial[i] = distr_prob(engine) <= cr || i == rand_idx ? doner[i] : target[i];
     }
-    return trial;
 }
-Solution Crossover_Exp::crossover_solution(const DE& de, const Solution& target, const Solution& doner)
+void Crossover_Exp::crossover_into(const DE& de, const Solution& target, const Solution& doner, Solution& trial)
 {
     const double cr  = de.cr();
     const size_t dim = de.dimension();
     assert(target.size() == dim && dim == doner.size());
     uniform_int_distribution<size_t>  distr_idx(0, dim - 1);
     uniform_real_distribution<double> distr_prob(0, 1);
-    Solution trial(target);
+    trial.assign(target.begin(), target.end());
     size_t l = 1;
     for(; distr_prob(engine) < cr && l < dim; ++l);
     const size_t start_idx = distr_idx(engine);
@@ -168,15 +232,285 @@ Solution Crossover_Exp::crossover_solution(const DE& de, const Solution& target,
     {
         trial[i % dim] = doner[i % dim];
     }
-    return trial;
 }
-pair<vector<Evaluated>, vector<Solution>> Selector_Epsilon::select(const DE& de
-        , const vector<Solution>& targets
-        , const vector<Solution>& trials
-        , const vector<Evaluated>& target_results
-        , const vector<Evaluated>& trial_results)
+Solution Crossover_SparseBin::crossover_solution(const DE& de, const Solution& target, const Solution& doner)
+{
+    SparseTrial trial;
+    crossover_sparse(de, 0, target, doner, trial);
+    Solution dense(target);
+    trial.apply(dense);
+    return dense;
+}
+void Crossover_SparseBin::crossover_sparse(const DE& de, size_t target_idx, const Solution&,
+                                           const Solution& doner, SparseTrial& trial)
 {
-    if (de.curr_gen() == 1)
+    assert(doner.size() == de.dimension());
+    sample_positions(de, target_idx, trial);
+    trial.value.resize(trial.index.size());
+    for (size_t k = 0; k < trial.index.size(); ++k)
+        trial.value[k] = doner[trial.index[k]];
+}
+void Crossover_SparseBin::sample_positions(const DE& de, size_t target_idx, SparseTrial& trial)
+{
+    const double cr  = de.cr();
+    const size_t dim = de.dimension();
+    uniform_int_distribution<size_t> distr_idx(0, dim - 1);
+    uniform_real_distribution<double> distr_prob(0, 1);
+    const size_t rand_idx = distr_idx(engine);
+    trial.target = target_idx;
+    trial.index.clear();
+    trial.value.clear();
+    // the gap between two crossover positions is geometric with success probability cr
+    const double log_q  = cr < 1 ? log1p(-cr) : 0;
+    size_t i            = 0;
+    bool rand_idx_taken = false;
+    while (i < dim && cr > 0)
+    {
+        if (cr < 1)
+        {
+            const double skip = floor(log1p(-distr_prob(engine)) / log_q);
+            if (skip >= static_cast<double>(dim - i))
+                break;
+            i += static_cast<size_t>(skip);
+        }
+        if (!rand_idx_taken && rand_idx <= i)
+        {
+            if (rand_idx < i)
+                trial.index.push_back(rand_idx);
+            rand_idx_taken = true;
+        }
+        trial.index.push_back(i);
+        ++i;
+    }
+    if (!rand_idx_taken)
+        trial.index.push_back(rand_idx);
+}
+namespace
+{
+// eigenvectors of the symmetric n x n matrix `a` by cyclic Jacobi rotations, written to `basis`
+// with eigenvector k at basis[k * n .. k * n + n - 1]
+void jacobi_eigenvectors(vector<double>& a, size_t n, vector<double>& basis)
+{
+    vector<double> v(n * n, 0); // [i][k]
+    for (size_t i = 0; i < n; ++i)
+        v[i * n + i] = 1;
+    for (size_t sweep = 0; sweep < 50; ++sweep)
+    {
+        double off = 0, diag = 0;
+        for (size_t p = 0; p < n; ++p)
+        {
+            diag += a[p * n + p] * a[p * n + p];
+            for (size_t q = p + 1; q < n; ++q)
+                off += a[p * n + q] * a[p * n + q];
+        }
+        if (off <= 1e-30 * diag || off == 0)
+            break;
+        for (size_t p = 0; p < n; ++p)
+        {
+            for (size_t q = p + 1; q < n; ++q)
+            {
+                const double apq = a[p * n + q];
+                if (fabs(apq) <= 1e-18 * sqrt(fabs(a[p * n + p] * a[q * n + q])))
+                    continue; // already negligible
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                const double t     = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                const double c     = 1 / sqrt(t * t + 1);
+                const double s     = t * c;
+                for (size_t k = 0; k < n; ++k)
+                {
+                    const double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p]     = c * akp - s * akq;
+                    a[k * n + q]     = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k)
+                {
+                    const double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k]     = c * apk - s * aqk;
+                    a[q * n + k]     = s * apk + c * aqk;
+                }
+                for (size_t k = 0; k < n; ++k)
+                {
+                    const double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p]     = c * vkp - s * vkq;
+                    v[k * n + q]     = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    basis.resize(n * n);
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < n; ++i)
+            basis[k * n + i] = v[i * n + k];
+}
+}
+Crossover_Eigen::Crossover_Eigen(size_t period, double prob, size_t max_dim)
+    : _period(period),
+      _prob(prob),
+      _max_dim(max_dim),
+      _synced_gen(0),
+      _n(0),
+      _stale(false),
+      _identity(true),
+      _launched_gen(0),
+      _refreshes(0)
+{
+    if (period == 0)
+        throw ConfigError("eig_period should be positive");
+    if (prob < 0 || prob > 1)
+        throw ConfigError("eig_prob should be in [0, 1]");
+}
+Crossover_Eigen::~Crossover_Eigen()
+{
+    _join();
+}
+void Crossover_Eigen::_join() noexcept
+{
+    if (_worker.joinable())
+        _worker.join();
+}
+void Crossover_Eigen::_recompute(const vector<Solution>& population)
+{
+    const size_t dim = _mean.size();
+    _n               = population.size();
+    _stale           = false;
+    fill(_mean.begin(), _mean.end(), 0);
+    fill(_scatter.begin(), _scatter.end(), 0);
+    for (const Solution& x : population)
+        for (size_t a = 0; a < dim; ++a)
+            _mean[a] += x[a] / static_cast<double>(_n);
+    for (const Solution& x : population)
+        for (size_t a = 0; a < dim; ++a)
+            for (size_t b = 0; b < dim; ++b)
+                _scatter[a * dim + b] += (x[a] - _mean[a]) * (x[b] - _mean[b]);
+}
+void Crossover_Eigen::_reset(const vector<Solution>& population)
+{
+    _join();
+    const size_t dim = population.empty() ? 0 : population[0].size();
+    _mean.assign(dim, 0);
+    _scatter.assign(dim * dim, 0);
+    _recompute(population);
+    _identity     = true;
+    _launched_gen = 0;
+}
+void Crossover_Eigen::_replace(const Solution& old_row, const Solution& new_row)
+{
+    // Welford downdate of the old row, then update with the new one
+    const size_t dim = _mean.size();
+    const double n   = static_cast<double>(_n);
+    thread_local vector<double> old_r, old_d, new_r, new_d;
+    old_r.resize(dim), old_d.resize(dim), new_r.resize(dim), new_d.resize(dim);
+    for (size_t a = 0; a < dim; ++a)
+    {
+        const double mean_r = _mean[a] + (_mean[a] - old_row[a]) / (n - 1);
+        const double mean_n = mean_r + (new_row[a] - mean_r) / n;
+        old_r[a]            = old_row[a] - mean_r;
+        old_d[a]            = old_row[a] - _mean[a];
+        new_r[a]            = new_row[a] - mean_r;
+        new_d[a]            = new_row[a] - mean_n;
+        _mean[a]            = mean_n;
+    }
+    for (size_t a = 0; a < dim; ++a)
+        for (size_t b = 0; b < dim; ++b)
+            _scatter[a * dim + b] += new_r[a] * new_d[b] - old_r[a] * old_d[b];
+}
+void Crossover_Eigen::_sync(const DE& de)
+{
+    const vector<Solution>& population = de.population();
+    const size_t gen = de.curr_gen();
+    if (gen < _synced_gen.load() || _n != population.size() || _mean.size() != de.dimension())
+        _reset(population); // new run
+    else if (_stale)
+        _recompute(population);
+    if (_worker.joinable() && gen >= _launched_gen + _period)
+    {
+        _join();
+        _basis.swap(_job_basis);
+        _identity = false;
+        ++_refreshes;
+    }
+    if (!_worker.joinable() && (_launched_gen == 0 || gen >= _launched_gen + _period))
+    {
+        // the incremental scatter drifts slowly, recompute it from the rows now and then
+        if (_refreshes > 0 && _refreshes % 20 == 0)
+            _recompute(population);
+        const size_t dim = _mean.size();
+        _job_cov         = _scatter;
+        _launched_gen    = gen;
+        _worker          = thread([this, dim]() { jacobi_eigenvectors(_job_cov, dim, _job_basis); });
+    }
+    _synced_gen.store(gen);
+}
+void Crossover_Eigen::population_changed(const DE& de, const vector<size_t>* replaced,
+                                         const vector<Solution>& previous)
+{
+    if (de.dimension() > _max_dim)
+        return;
+    if (replaced == nullptr || _n != de.np() || _mean.size() != de.dimension())
+    {
+        _stale = true;
+        return;
+    }
+    const vector<Solution>& population = de.population();
+    for (size_t i : *replaced)
+        _replace(previous[i], population[i]);
+}
+void Crossover_Eigen::crossover_into(const DE& de, const Solution& target, const Solution& doner, Solution& trial)
+{
+    if (de.dimension() > _max_dim)
+    {
+        // the covariance would cost O(dim^2) memory and its decomposition O(dim^3) time
+        _bin.crossover_into(de, target, doner, trial);
+        return;
+    }
+    if (_synced_gen.load() != de.curr_gen())
+    {
+        lock_guard<mutex> lock(_m);
+        if (_synced_gen.load() != de.curr_gen())
+            _sync(de);
+    }
+    const double cr  = de.cr();
+    const size_t dim = de.dimension();
+    uniform_int_distribution<size_t> distr_idx(0, dim - 1);
+    uniform_real_distribution<double> distr_prob(0, 1);
+    trial.resize(dim);
+    const bool rotated    = !_identity && distr_prob(engine) < _prob;
+    const size_t rand_idx = distr_idx(engine);
+    if (!rotated)
+    {
+        for (size_t i = 0; i < dim; ++i)
+            trial[i] = distr_prob(engine) <= cr || i == rand_idx ? doner[i] : target[i];
+        return;
+    }
+    thread_local vector<double> diff, out;
+    diff.resize(dim);
+    out.assign(target.begin(), target.end());
+    for (size_t i = 0; i < dim; ++i)
+        diff[i] = doner[i] - target[i];
+    for (size_t k = 0; k < dim; ++k)
+    {
+        if (!(distr_prob(engine) <= cr || k == rand_idx))
+            continue;
+        const double* e = &_basis[k * dim];
+        double y        = 0;
+        for (size_t i = 0; i < dim; ++i)
+            y += e[i] * diff[i];
+        for (size_t i = 0; i < dim; ++i)
+            out[i] += y * e[i];
+    }
+    for (size_t i = 0; i < dim; ++i)
+    {
+        const pair<double, double> rg = de.range(i);
+        if (out[i] < rg.first)
+            out[i] = (target[i] + rg.first) / 2;
+        else if (out[i] > rg.second)
+            out[i] = (target[i] + rg.second) / 2;
+        trial[i] = static_cast<Scalar>(out[i]);
+    }
+}
+void Selector_Epsilon::init_epsilon(const DE& de, const vector<Evaluated>& target_results)
+{
+    if (de.curr_gen() == 1 && !epsilon_ready)
     {
         vector<double> violations(de.np(), numeric_limits<double>::infinity());
         for (size_t i = 0; i < target_results.size(); ++i)
@@ -185,19 +519,54 @@ pair<vector<Evaluated>, vector<Solution>> Selector_Epsilon::select(const DE& de
         partial_sort(violations.begin(), violations.begin() + cutoff, violations.end());
         epsilon_0     = violations[cutoff - 1];
         epsilon_level = epsilon_0;
+        epsilon_ready = true;
     }
-    auto ret      = ISelector::select(de, targets, trials, target_results, trial_results);
+}
+void Selector_Epsilon::update_epsilon(const DE& de)
+{
     size_t gen    = de.curr_gen();
-    cout << "Epsilon level: " << epsilon_level << endl;
+    if (de.log() != nullptr)
+        *de.log() << "Epsilon level: " << epsilon_level << endl;
     epsilon_level = gen > tc ? 0 : epsilon_0 * pow(1.0 - (double)gen / (double)tc, (double)cp);
+    epsilon_ready = false;
+}
+pair<vector<Evaluated>, vector<Solution>> Selector_Epsilon::select(const DE& de
+        , const vector<Solution>& targets
+        , const vector<Solution>& trials
+        , const vector<Evaluated>& target_results
+        , const vector<Evaluated>& trial_results)
+{
+    init_epsilon(de, target_results);
+    auto ret      = ISelector::select(de, targets, trials, target_results, trial_results);
+    update_epsilon(de);
     return ret;
 }
+void Selector_Epsilon::select_sparse(const DE& de, vector<Solution>& targets, vector<Evaluated>& target_results,
+                                     const vector<SparseTrial>& trials, const vector<Evaluated>& trial_results)
+{
+    init_epsilon(de, target_results);
+    ISelector::select_sparse(de, targets, target_results, trials, trial_results);
+    update_epsilon(de);
+}
+void Selector_Epsilon::select_inplace(const DE& de, vector<Solution>& targets, vector<Evaluated>& target_results,
+                                      vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    init_epsilon(de, target_results);
+    swap_winners(de, targets, target_results, trials, trial_results);
+    update_epsilon(de);
+}
 bool Selector_StaticPenalty::better(const Evaluated& r1, const Evaluated& r2)
 {
     const double fom1 = r1.first + accumulate(r1.second.begin(), r1.second.end(), 0.0);
     const double fom2 = r2.first + accumulate(r2.second.begin(), r2.second.end(), 0.0);
     return fom1 <= fom2;
 }
+void Selector_StaticPenalty::select_inplace(const DE& de, vector<Solution>& targets,
+                                            vector<Evaluated>& target_results, vector<Solution>& trials,
+                                            vector<Evaluated>& trial_results)
+{
+    swap_winners(de, targets, target_results, trials, trial_results);
+}
 bool Selector_FeasibilityRule::better(const Evaluated& r1, const Evaluated& r2)
 {
     const double fom1       = r1.first;
@@ -211,6 +580,26 @@ bool Selector_FeasibilityRule::better(const Evaluated& r1, const Evaluated& r2)
     else
         return violation1 == 0;
 }
+bool Selector_FeasibilityRule::can_win(const DE&, const ConstraintViolation& vio, const Evaluated& target)
+{
+    // a feasible target only loses to feasible trials, an infeasible one to less violating trials
+    const double violation1 = accumulate(vio.begin(), vio.end(), 0.0);
+    const double violation2 = accumulate(target.second.begin(), target.second.end(), 0.0);
+    return violation1 <= violation2;
+}
+void Selector_FeasibilityRule::select_inplace(const DE& de, vector<Solution>& targets,
+                                              vector<Evaluated>& target_results, vector<Solution>& trials,
+                                              vector<Evaluated>& trial_results)
+{
+    swap_winners(de, targets, target_results, trials, trial_results);
+}
+bool Selector_Epsilon::can_win(const DE& de, const ConstraintViolation& vio, const Evaluated& target)
+{
+    init_epsilon(de, de.evaluated()); // the level of the first generation isn't set before selection
+    const double violation1 = accumulate(vio.begin(), vio.end(), 0.0);
+    const double violation2 = accumulate(target.second.begin(), target.second.end(), 0.0);
+    return violation1 <= epsilon_level || violation1 <= violation2;
+}
 bool Selector_Epsilon::better(const Evaluated& r1, const Evaluated& r2)
 {
     const double fom1       = r1.first;
@@ -3,6 +3,7 @@
 #include "global.h"
 #include <random>
 #include <cassert>
+#include <algorithm>
 using namespace std;
 double IMutator::boundary_constraint(pair<double, double> rg, double val) const noexcept
 {
@@ -12,24 +13,63 @@ double IMutator::boundary_constraint(pair<double, double> rg, double val) const
 }
 std::vector<Solution> IMutator::mutation(const DE& de)
 {
-    vector<Solution> mutated;
-    mutated.reserve(de.population().size());
+    vector<Solution> mutated(de.population().size(), Solution(de.dimension()));
     for (size_t i = 0; i < de.population().size(); ++i)
     {
-        mutated.push_back(mutation_solution(de, i));
+        mutate_into(de, i, mutated[i]);
     }
     return mutated;
 }
+void IMutator::mutate_all(const DE& de, vector<Solution>& out)
+{
+    const vector<Solution> doners = mutation(de);
+    assert(doners.size() == out.size());
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i].assign(doners[i].begin(), doners[i].end());
+}
+void IMutator::mutate_at(const DE& de, size_t idx, const vector<size_t>& index, Solution& value)
+{
+    thread_local Solution doner;
+    doner.resize(de.dimension());
+    mutate_into(de, idx, doner);
+    value.resize(index.size());
+    for (size_t k = 0; k < index.size(); ++k)
+        value[k] = doner[index[k]];
+}
 vector<Solution> ICrossover::crossover(const DE& de, const vector<Solution>& targets,
                                        const vector<Solution>& doners)
 {
     vector<Solution> trials(de.np(), Solution(de.dimension()));
     for (size_t i = 0; i < de.np(); ++i)
     {
-        trials[i] = crossover_solution(de, targets[i], doners[i]);
+        crossover_into(de, targets[i], doners[i], trials[i]);
     }
     return trials;
 }
+void ICrossover::crossover_all(const DE& de, const vector<Solution>& targets, const vector<Solution>& doners,
+                               vector<Solution>& trials)
+{
+    const vector<Solution> crossed = crossover(de, targets, doners);
+    assert(crossed.size() == trials.size());
+    for (size_t i = 0; i < trials.size(); ++i)
+        trials[i].assign(crossed[i].begin(), crossed[i].end());
+}
+void ICrossover::crossover_sparse(const DE& de, size_t target_idx, const Solution& target,
+                                  const Solution& doner, SparseTrial& trial)
+{
+    const Solution dense = crossover_solution(de, target, doner);
+    trial.target = target_idx;
+    trial.index.clear();
+    trial.value.clear();
+    for (size_t i = 0; i < dense.size(); ++i)
+    {
+        if (dense[i] != target[i])
+        {
+            trial.index.push_back(i);
+            trial.value.push_back(dense[i]);
+        }
+    }
+}
 pair<vector<Evaluated>, vector<Solution>> ISelector::select(const DE& de,
                                                             const vector<Solution>& targets,
                                                             const vector<Solution>& trials,
@@ -50,3 +90,43 @@ pair<vector<Evaluated>, vector<Solution>> ISelector::select(const DE& de,
     }
     return make_pair(child_results, offspring);
 }
+void ISelector::select_sparse(const DE& de, vector<Solution>& targets, vector<Evaluated>& target_results,
+                              const vector<SparseTrial>& trials, const vector<Evaluated>& trial_results)
+{
+    assert(targets.size() == de.np() && de.np() == trials.size());
+    assert(target_results.size() == de.np() && de.np() == trial_results.size());
+    for (size_t i = 0; i < de.np(); ++i)
+    {
+        if (better(trial_results[i], target_results[i]))
+        {
+            trials[i].apply(targets[i]);
+            target_results[i] = trial_results[i];
+        }
+    }
+}
+void ISelector::select_inplace(const DE& de, vector<Solution>& targets, vector<Evaluated>& target_results,
+                               vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    // copied row by row, so the targets keep their storage
+    _replaced_known = false;
+    auto new_result = select(de, targets, trials, target_results, trial_results);
+    copy(new_result.first.begin(), new_result.first.end(), target_results.begin());
+    copy(new_result.second.begin(), new_result.second.end(), targets.begin());
+}
+void ISelector::swap_winners(const DE& de, vector<Solution>& targets, vector<Evaluated>& target_results,
+                             vector<Solution>& trials, vector<Evaluated>& trial_results)
+{
+    assert(targets.size() == de.np() && de.np() == trials.size());
+    assert(target_results.size() == de.np() && de.np() == trial_results.size());
+    _replaced.clear();
+    _replaced_known = true;
+    for (size_t i = 0; i < de.np(); ++i)
+    {
+        if (better(trial_results[i], target_results[i]))
+        {
+            targets[i].swap(trials[i]);
+            target_results[i].swap(trial_results[i]);
+            _replaced.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,416 @@
+// de-run: optimize an objective loaded from a shared library (see de_objective.h)
+//
+//     de-run <config file> [key=value ...]
+//
+// The config file holds the DEConfig keys (see DEConfig.h) and the keys of this program:
+//     objective      path of the shared library, required
+//     objective_arg  string passed to de_setup
+//     threads        number of evaluation threads, default: OpenMP default
+//     cpus           CPU list the process is bound to, e.g. 0-7,16
+//     output         path of the JSON result, default: standard output
+//     verbose        0 disables the per-generation progress on standard error
+//     metrics        serve live Prometheus metrics on `unix:/path` or a localhost port (see Metrics.h)
+//     cache          path of a persistent evaluation cache shared by runs (see EvalCache.h)
+//     cache_tag      objective version of the cached values, default: objective and objective_arg
+//     cache_resolution  quantization relative to the range widths, default 1e-9
+// `restarts` or `budget` run IPOP restarts (see Restart.h), `local_search` polishes the best individuals
+// on extra threads besides `threads` (see LocalSearch.h), `key=value` arguments override the config file.
+#include "DifferentialEvolution.h"
+#include "de_objective.h"
+#include <dlfcn.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+using namespace std;
+namespace
+{
+double elapsed_since(const chrono::steady_clock::time_point& t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+// the point as the double array of the C interface, converted through `buf` in single precision
+#ifdef DE_SINGLE_PRECISION
+const double* as_double(const Solution& x, vector<double>& buf)
+{
+    buf.assign(x.begin(), x.end());
+    return buf.data();
+}
+#else
+const double* as_double(const Solution& x, vector<double>&) { return x.data(); }
+#endif
+Evaluated invalid_point()
+{
+    return Evaluated(numeric_limits<double>::infinity(),
+                     ConstraintViolation{numeric_limits<double>::infinity()});
+}
+
+class ObjectiveLibrary
+{
+public:
+    explicit ObjectiveLibrary(const string& path) : _handle(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL))
+    {
+        if (_handle == nullptr)
+            throw runtime_error(string("Can't load objective: ") + dlerror());
+        auto version = _symbol<decltype(&de_abi_version)>("de_abi_version", true);
+        if (version() != DE_OBJECTIVE_ABI_VERSION)
+            throw runtime_error(path + ": objective ABI version " + to_string(version()) + ", expected " +
+                                to_string(DE_OBJECTIVE_ABI_VERSION));
+        _dim            = _symbol<decltype(&de_dimension)>("de_dimension", true)();
+        _num_constraint = _symbol<decltype(&de_num_constraints)>("de_num_constraints", true)();
+        _bounds         = _symbol<decltype(&de_bounds)>("de_bounds", true);
+        _eval           = _symbol<decltype(&de_evaluate)>("de_evaluate", false);
+        _eval_batch     = _symbol<decltype(&de_evaluate_batch)>("de_evaluate_batch", false);
+        _setup          = _symbol<decltype(&de_setup)>("de_setup", false);
+        _teardown       = _symbol<decltype(&de_teardown)>("de_teardown", false);
+        if (_eval == nullptr && _eval_batch == nullptr)
+            throw runtime_error(path + ": neither de_evaluate nor de_evaluate_batch is exported");
+    }
+    ~ObjectiveLibrary()
+    {
+        if (_set_up && _teardown != nullptr)
+            _teardown();
+        dlclose(_handle);
+    }
+    ObjectiveLibrary(const ObjectiveLibrary&) = delete;
+    ObjectiveLibrary& operator=(const ObjectiveLibrary&) = delete;
+
+    void setup(const string& arg)
+    {
+        if (_setup != nullptr && _setup(arg.c_str()) != 0)
+            throw runtime_error("de_setup failed");
+        _set_up = true;
+    }
+    bool batch() const noexcept { return _eval_batch != nullptr; }
+    bool point() const noexcept { return _eval != nullptr; }
+    Ranges ranges() const
+    {
+        vector<double> lower(_dim), upper(_dim);
+        _bounds(lower.data(), upper.data());
+        Ranges rg(_dim);
+        for (size_t i = 0; i < _dim; ++i)
+            rg[i] = make_pair(lower[i], upper[i]);
+        return rg;
+    }
+    Objective objective() const
+    {
+        return [this](const size_t idx, const Solution& x) -> Evaluated {
+            thread_local vector<double> buf;
+            Evaluated y(0, ConstraintViolation(_num_constraint, 0));
+            if (_eval(idx, as_double(x, buf), &y.first, y.second.data()) != 0)
+                return invalid_point();
+            return y;
+        };
+    }
+    BatchObjective batch_objective() const
+    {
+        return [this](const vector<Solution>& xs, vector<Evaluated>& results) {
+            const size_t n = xs.size();
+            vector<double> flat(n * _dim), foms(n), violations(n * _num_constraint);
+            for (size_t i = 0; i < n; ++i)
+                copy(xs[i].begin(), xs[i].end(), flat.begin() + i * _dim);
+            if (_eval_batch(n, flat.data(), foms.data(), violations.data()) != 0)
+            {
+                fill(results.begin(), results.end(), invalid_point());
+                return;
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                const auto vio = violations.begin() + i * _num_constraint;
+                results[i]     = Evaluated(foms[i], ConstraintViolation(vio, vio + _num_constraint));
+            }
+        };
+    }
+
+private:
+    void* _handle;
+    size_t _dim;
+    size_t _num_constraint;
+    decltype(&de_bounds) _bounds;
+    decltype(&de_evaluate) _eval;
+    decltype(&de_evaluate_batch) _eval_batch;
+    decltype(&de_setup) _setup;
+    decltype(&de_teardown) _teardown;
+    bool _set_up = false;
+
+    template <typename Fn>
+    Fn _symbol(const char* name, bool required) const
+    {
+        void* sym = dlsym(_handle, name);
+        if (sym == nullptr && required)
+            throw runtime_error(string("Missing symbol in objective: ") + name);
+        return reinterpret_cast<Fn>(sym);
+    }
+};
+
+// bind the calling thread before any worker is started, the OpenMP and pool threads inherit it
+void bind_cpus(const vector<int>& cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus)
+    {
+        if (c >= CPU_SETSIZE)
+            throw ConfigError("cpu " + to_string(c) + " out of range");
+        CPU_SET(c, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        throw runtime_error("sched_setaffinity failed");
+#else
+    (void)cpus;
+    cerr << "de-run: cpus is ignored on this platform" << endl;
+#endif
+}
+
+string take(unordered_map<string, string>& kv, const string& key, const string& default_val)
+{
+    auto iter = kv.find(key);
+    if (iter == kv.end())
+        return default_val;
+    const string val = iter->second;
+    kv.erase(iter);
+    return val;
+}
+
+// minimal JSON writer
+string json_string(const string& s)
+{
+    string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+string json_number(double v)
+{
+    if (std::isnan(v) || std::isinf(v))
+        return "null";
+    stringstream ss;
+    ss << setprecision(17) << v;
+    return ss.str();
+}
+template <typename T>
+string json_array(const vector<T>& xs)
+{
+    string out = "[";
+    for (size_t i = 0; i < xs.size(); ++i)
+        out += (i == 0 ? "" : ", ") + json_number(xs[i]);
+    return out + "]";
+}
+template <typename Enum>
+string lut_name(const unordered_map<string, Enum>& lut, Enum val)
+{
+    for (const auto& kv : lut)
+        if (kv.second == val)
+            return kv.first;
+    return "?";
+}
+
+int run(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        cerr << "usage: " << argv[0] << " <config file> [key=value ...]" << endl;
+        return EXIT_FAILURE;
+    }
+    const auto t_start                = chrono::steady_clock::now();
+    unordered_map<string, string> kv = DEConfig::read_file(argv[1]);
+    for (int i = 2; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        const size_t eq  = arg.find('=');
+        if (eq == string::npos || eq == 0)
+            throw ConfigError("Expected key=value, got " + arg);
+        kv[arg.substr(0, eq)] = arg.substr(eq + 1);
+    }
+    const string objective_path = take(kv, "objective", "");
+    const string objective_arg  = take(kv, "objective_arg", "");
+    const string threads_str    = take(kv, "threads", "0");
+    const string cpus_str       = take(kv, "cpus", "");
+    const string output         = take(kv, "output", "");
+    const bool verbose          = take(kv, "verbose", "1") != "0";
+    const string metrics_addr   = take(kv, "metrics", "");
+    const string cache_path     = take(kv, "cache", "");
+    const string cache_tag      = take(kv, "cache_tag", objective_path + "\n" + objective_arg);
+    const double cache_res      = stod(take(kv, "cache_resolution", "1e-9"));
+    if (objective_path.empty())
+        throw ConfigError("objective is required");
+    const DEConfig conf = DEConfig::from_strings(kv);
+    conf.validate();
+
+    vector<int> cpus;
+    if (!cpus_str.empty())
+    {
+        cpus = parse_cpu_list(cpus_str);
+        bind_cpus(cpus);
+    }
+    int threads = stoi(threads_str);
+    if (threads < 0)
+        throw ConfigError("threads should be non-negative");
+    if (threads == 0)
+        threads = cpus.empty() ? omp_get_max_threads() : static_cast<int>(cpus.size());
+    omp_set_num_threads(threads);
+    ThreadPool::set_default_size(threads > 1 ? threads - 1 : 1); // the calling thread helps
+
+    const auto t_load = chrono::steady_clock::now();
+    ObjectiveLibrary lib(objective_path);
+    lib.setup(objective_arg);
+    const double load_seconds = elapsed_since(t_load);
+
+    if (conf.local_search.enabled && !lib.point())
+        throw ConfigError("local_search requires de_evaluate, de_evaluate_batch can't run concurrently with the batches");
+    const Ranges ranges = lib.ranges();
+    const Objective objf = lib.objective();
+    unique_ptr<DE> de;
+    switch (conf.variant)
+    {
+        case Origin:
+            de.reset(new DE(objf, ranges, conf));
+            break;
+        case RandomF:
+            de.reset(new DERandomF(objf, ranges, conf));
+            break;
+        case SelfAdaptive:
+            de.reset(new SaDE(objf, ranges, conf));
+            break;
+        default:
+            throw ConfigError("Unrecognized DE variant");
+    }
+    if (lib.batch())
+        de->set_batch_objective(lib.batch_objective());
+    de->set_log(verbose ? &cerr : nullptr);
+    if (!cache_path.empty())
+        de->enable_eval_cache(cache_path, cache_tag, cache_res);
+    unique_ptr<MetricsServer> metrics; // after `de`, so it stops serving first
+    if (!metrics_addr.empty())
+    {
+        metrics.reset(new MetricsServer(metrics_addr));
+        metrics->add("de-run", de->metrics());
+        if (verbose)
+            cerr << "metrics on " << metrics->address() << endl;
+    }
+    vector<double> curve;
+    de->set_generation_callback([&](const DE& d) -> bool {
+        curve.push_back(d.evaluated()[d.find_best()].first);
+        return true;
+    });
+
+    const auto t_solve          = chrono::steady_clock::now();
+    unique_ptr<RestartController> restarts;
+    if (conf.restart.max_restarts > 0 || conf.restart.budget > 0)
+        restarts.reset(new RestartController(*de));
+    const Solution best         = restarts ? restarts->solver() : de->solver();
+    const double solve_seconds  = elapsed_since(t_solve);
+    const Evaluated best_y      = restarts ? restarts->best_result() : de->evaluated()[de->find_best()];
+    const EvalScheduler& sched  = de->scheduler();
+    const LatencyHistogram& lat = sched.latency();
+    double violation            = 0;
+    for (double v : best_y.second)
+        violation += v;
+
+    stringstream js;
+    js << "{\n"
+       << "  \"objective\": " << json_string(objective_path) << ",\n"
+       << "  \"config\": {\"variant\": " << json_string(lut_name(dv_lut, conf.variant))
+       << ", \"mutation\": " << json_string(lut_name(ms_lut, conf.ms))
+       << ", \"crossover\": " << json_string(lut_name(cs_lut, conf.cs))
+       << ", \"selection\": " << json_string(lut_name(ss_lut, conf.ss))
+       << ", \"schedule\": " << json_string(lib.batch() ? "batch" : lut_name(sp_lut, conf.schedule))
+       << ", \"f\": " << json_number(conf.f) << ", \"cr\": " << json_number(conf.cr) << ", \"np\": " << conf.np
+       << ", \"max_iter\": " << conf.max_iter << ", \"seed\": " << (conf.seeded ? to_string(conf.seed) : "null")
+       << ", \"threads\": " << threads << ", \"cpus\": " << json_string(cpus_str) << "},\n"
+       << "  \"build\": {\"optimized\": "
+#ifdef NDEBUG
+       << "true"
+#else
+       << "false"
+#endif
+       << ", \"scalar\": " << json_string(sizeof(Scalar) == sizeof(float) ? "float" : "double") << "},\n"
+       << "  \"best\": {\"fom\": " << json_number(best_y.first) << ", \"violation\": " << json_number(violation)
+       << ", \"constraints\": " << json_array(best_y.second) << ", \"x\": " << json_array(best) << "},\n"
+       << "  \"generations\": " << curve.size() + (restarts ? restarts->runs().size() : 1) << ",\n"
+       << "  \"evaluations\": " << sched.evaluations() << ",\n"
+       << "  \"timings\": {\"load_seconds\": " << json_number(load_seconds)
+       << ", \"solve_seconds\": " << json_number(solve_seconds)
+       << ", \"total_seconds\": " << json_number(elapsed_since(t_start))
+       << ", \"eval_busy_seconds\": " << json_number(sched.busy_time())
+       << ", \"eval_wall_seconds\": " << json_number(sched.wall_time())
+       << ", \"parallel_efficiency\": " << json_number(sched.efficiency())
+       << ", \"eval_latency_mean\": " << json_number(lat.mean())
+       << ", \"eval_latency_p50\": " << json_number(lat.quantile(0.5))
+       << ", \"eval_latency_p99\": " << json_number(lat.quantile(0.99))
+       << ", \"eval_latency_max\": " << json_number(lat.max()) << "},\n"
+       << "  \"restarts\": [";
+    for (size_t r = 0; restarts && r < restarts->runs().size(); ++r)
+    {
+        const RestartRun& run = restarts->runs()[r];
+        js << (r == 0 ? "" : ", ") << "{\"np\": " << run.np << ", \"generations\": " << run.generations
+           << ", \"evaluations\": " << run.evaluations << ", \"fom\": " << json_number(run.best_result.first)
+           << ", \"stagnated\": " << (run.stagnated ? "true" : "false") << "}";
+    }
+    js << "],\n"
+       << "  \"local_search\": ";
+    if (const LocalSearch* ls = de->local_search())
+        js << "{\"method\": " << json_string(lut_name(ls_lut, ls->config().method))
+           << ", \"launches\": " << ls->stats().launches << ", \"improved\": " << ls->stats().improved
+           << ", \"injected\": " << ls->stats().injected << ", \"evaluations\": " << ls->stats().evaluations
+           << ", \"fraction\": " << json_number(ls->fraction(sched.evaluations())) << "},\n";
+    else
+        js << "null,\n";
+    js << "  \"cache\": ";
+    if (const EvalCache* cache = de->eval_cache())
+        js << "{\"path\": " << json_string(cache->path()) << ", \"lookups\": " << cache->lookups()
+           << ", \"hits\": " << cache->hits() << ", \"hit_rate\": " << json_number(cache->hit_rate())
+           << ", \"inserted\": " << cache->inserted() << ", \"records\": " << cache->records() << "},\n";
+    else
+        js << "null,\n";
+    js << "  \"curve\": " << json_array(curve) << "\n"
+       << "}\n";
+    if (output.empty())
+        cout << js.str();
+    else
+    {
+        ofstream ofs(output);
+        if (!(ofs << js.str()))
+            throw runtime_error("Can't write " + output);
+    }
+    return EXIT_SUCCESS;
+}
+}
+int main(int argc, char** argv)
+{
+    try
+    {
+        return run(argc, argv);
+    }
+    catch (const exception& e)
+    {
+        cerr << "de-run: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -2,7 +2,7 @@
 #include <random>
 using namespace std;
 #ifndef NDEBUG // debug mode
-mt19937_64 engine(0);
+thread_local mt19937_64 engine(0);
 #else // release mode
-mt19937_64 engine(random_device{}());
+thread_local mt19937_64 engine(random_device{}());
 #endif
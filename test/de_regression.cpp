@@ -0,0 +1,357 @@
+// de-regression: end-to-end regression harness of DE and SaDE (ctest target `regression`)
+//
+//     de-regression <baseline file> [--record | --strict-time]
+//
+// Runs fixed-seed DE and SaDE configurations on standard unconstrained and constrained problems,
+// each `timed_runs` times, and fails when
+//     the runs of a case don't give the same solution (reproducibility)
+//     the final FOM or violation moved away from the baseline by more than `fom_tolerance` (relative)
+//     the evaluations to reach the target of the problem grew by more than `evals_tolerance` (relative),
+//         or the target isn't reached anymore
+//     with --strict-time only, the wall-clock per generation grew by more than `time_tolerance`
+//         (relative); otherwise it is a warning, a loaded machine easily slows the runs down that much
+// The wall-clock per generation is the fastest of the runs divided by the time of a fixed calibration
+// loop, so a baseline recorded on one machine holds on another. The evaluations run on one thread.
+// A seeded run is exact only for one compiler, libm and precision: the baseline values are keyed by
+// the build configuration (`build_id`), and the cases of a build without a baseline are only checked
+// for reproducibility. `--record` rewrites the baseline of this build, keeping the other builds',
+// after a change that is meant to alter the results or to add a build.
+#include "DifferentialEvolution.h"
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <cstdlib>
+#include <stdexcept>
+using namespace std;
+namespace
+{
+const double pi        = 3.14159265358979323846;
+const size_t timed_runs = 5;
+// compiler, precision, architecture and C library, the values of a seeded run depend on all of them
+string build_id()
+{
+    ostringstream id;
+#if defined(__clang__)
+    id << "clang-" << __clang_major__ << "." << __clang_minor__ << "." << __clang_patchlevel__;
+#elif defined(__GNUC__)
+    id << "gcc-" << __GNUC__ << "." << __GNUC_MINOR__ << "." << __GNUC_PATCHLEVEL__;
+#else
+    id << "cc";
+#endif
+#ifdef DE_SINGLE_PRECISION
+    id << "-single";
+#else
+    id << "-double";
+#endif
+#if defined(__x86_64__)
+    id << "-x86_64";
+#elif defined(__aarch64__)
+    id << "-aarch64";
+#endif
+#ifdef __GLIBC__
+    id << "-glibc-" << __GLIBC__ << "." << __GLIBC_MINOR__;
+#endif
+    return id.str();
+}
+struct Problem
+{
+    string name;
+    Ranges ranges;
+    Objective func;
+    double target; // FOM of a feasible best counted as solved
+};
+struct Case
+{
+    string name;
+    const Problem* problem;
+    DEConfig conf;
+};
+struct Measure
+{
+    Solution best;
+    double fom             = 0;
+    double violation       = 0;
+    size_t evals_to_target = 0; // 0: never reached
+    double seconds_per_gen = 0;
+};
+
+ConstraintViolation positive_parts(initializer_list<double> gs)
+{
+    ConstraintViolation v;
+    for (double g : gs)
+        v.push_back(max(0.0, g));
+    return v;
+}
+vector<Problem> problems()
+{
+    vector<Problem> ps;
+    ps.push_back({"sphere", Ranges(10, {-100, 100}),
+                  [](size_t, const Solution& x) -> Evaluated {
+                      double s = 0;
+                      for (Scalar v : x)
+                          s += v * v;
+                      return {s, {}};
+                  },
+                  1e-8});
+    ps.push_back({"rosenbrock", Ranges(10, {-30, 30}),
+                  [](size_t, const Solution& x) -> Evaluated {
+                      double s = 0;
+                      for (size_t i = 0; i + 1 < x.size(); ++i)
+                          s += 100 * pow(x[i + 1] - x[i] * x[i], 2) + pow(1 - x[i], 2);
+                      return {s, {}};
+                  },
+                  1e-2});
+    ps.push_back({"rastrigin", Ranges(10, {-5.12, 5.12}),
+                  [](size_t, const Solution& x) -> Evaluated {
+                      double s = 10.0 * x.size();
+                      for (Scalar v : x)
+                          s += v * v - 10 * cos(2 * pi * v);
+                      return {s, {}};
+                  },
+                  1e-2});
+    // CEC 2006 g06, optimum -6961.81388
+    ps.push_back({"g06", Ranges{{13, 100}, {0, 100}},
+                  [](size_t, const Solution& x) -> Evaluated {
+                      const double f = pow(x[0] - 10, 3) + pow(x[1] - 20, 3);
+                      return {f, positive_parts({-pow(x[0] - 5, 2) - pow(x[1] - 5, 2) + 100,
+                                                 pow(x[0] - 6, 2) + pow(x[1] - 5, 2) - 82.81})};
+                  },
+                  -6961.8});
+    // CEC 2006 g01, optimum -15
+    Ranges g01(13, {0, 1});
+    g01[9] = g01[10] = g01[11] = {0, 100};
+    ps.push_back({"g01", g01,
+                  [](size_t, const Solution& x) -> Evaluated {
+                      double f = 0;
+                      for (size_t i = 0; i < 4; ++i)
+                          f += 5 * x[i] - 5 * x[i] * x[i];
+                      for (size_t i = 4; i < 13; ++i)
+                          f -= x[i];
+                      return {f, positive_parts({2 * x[0] + 2 * x[1] + x[9] + x[10] - 10,
+                                                 2 * x[0] + 2 * x[2] + x[9] + x[11] - 10,
+                                                 2 * x[1] + 2 * x[2] + x[10] + x[11] - 10,
+                                                 -8 * x[0] + x[9], -8 * x[1] + x[10], -8 * x[2] + x[11],
+                                                 -2 * x[3] - x[4] + x[9], -2 * x[5] - x[6] + x[10],
+                                                 -2 * x[7] - x[8] + x[11]})};
+                  },
+                  -14.999});
+    return ps;
+}
+vector<Case> cases(const vector<Problem>& ps)
+{
+    DEConfig de;
+    de.ms       = Rand1;
+    de.cs       = Bin;
+    de.ss       = FeasibilityRule;
+    de.f        = 0.6;
+    de.cr       = 0.9;
+    de.np       = 50;
+    de.max_iter = 1000;
+    de.seeded   = true;
+    de.seed     = 2024;
+    DEConfig sade     = de;
+    sade.variant      = SelfAdaptive;
+    sade.sade.given   = true;
+    sade.sade.lp      = 20;
+    sade.sade.fmu     = 0.5;
+    sade.sade.fsigma  = 0.3;
+    sade.sade.crmu    = 0.5;
+    sade.sade.crsigma = 0.1;
+    vector<Case> cs;
+    for (const Problem& p : ps)
+    {
+        cs.push_back({"de." + p.name, &p, de});
+        cs.push_back({"sade." + p.name, &p, sade});
+    }
+    return cs;
+}
+double seconds_since(const chrono::steady_clock::time_point& t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+// best of a few runs of a fixed mix of random numbers, scattered loads and arithmetic
+double calibration_seconds()
+{
+    double best = numeric_limits<double>::infinity();
+    for (int rep = 0; rep < 5; ++rep)
+    {
+        mt19937_64 gen(1);
+        vector<double> a(4096, 1.0);
+        const auto t0 = chrono::steady_clock::now();
+        double acc    = 0;
+        for (size_t i = 0; i < 2000000; ++i)
+        {
+            const size_t k = gen() % a.size();
+            a[k]           = 0.5 * a[k] + a[(k * 7 + 1) % a.size()] * 0.25 + 1e-3;
+            acc += a[k];
+        }
+        best = min(best, seconds_since(t0));
+        if (acc < 0)
+            cout << acc; // keeps the loop
+    }
+    return best;
+}
+Measure run(const Case& c)
+{
+    const Problem& p = *c.problem;
+    unique_ptr<DE> de;
+    if (c.conf.variant == SelfAdaptive)
+        de.reset(new SaDE(p.func, p.ranges, c.conf));
+    else
+        de.reset(new DE(p.func, p.ranges, c.conf));
+    de->set_log(nullptr);
+    Measure m;
+    de->set_generation_callback([&](const DE& d) {
+        const Metrics& mt = d.metrics();
+        if (m.evals_to_target == 0 && mt.best_violation() == 0 && mt.best_fom() <= p.target)
+            m.evals_to_target = mt.evaluations();
+        return true;
+    });
+    const auto t0     = chrono::steady_clock::now();
+    m.best            = de->solver();
+    m.seconds_per_gen = seconds_since(t0) / c.conf.max_iter;
+    m.fom             = de->metrics().best_fom();
+    m.violation       = de->metrics().best_violation();
+    return m;
+}
+bool within(double value, double base, double tol)
+{
+    return fabs(value - base) <= tol * max(1.0, fabs(base));
+}
+double get(const unordered_map<string, string>& m, const string& key)
+{
+    auto it = m.find(key);
+    if (it == m.end())
+        throw runtime_error("missing baseline key " + key + ", run with --record");
+    return stod(it->second);
+}
+int regression(int argc, char** argv)
+{
+    if (argc < 2)
+        throw runtime_error("usage: de-regression <baseline file> [--record | --strict-time]");
+    const string path      = argv[1];
+    const bool record      = argc > 2 && string(argv[2]) == "--record";
+    const bool strict_time = argc > 2 && string(argv[2]) == "--strict-time";
+    const string build     = build_id();
+    omp_set_num_threads(1);
+    const double unit        = calibration_seconds();
+    const vector<Problem> ps = problems();
+    const vector<Case> all   = cases(ps);
+    unordered_map<string, string> base;
+    double fom_tol = 1e-9, evals_tol = 0.1, time_tol = 0.5;
+    try
+    {
+        base      = DEConfig::read_file(path);
+        fom_tol   = get(base, "fom_tolerance");
+        evals_tol = get(base, "evals_tolerance");
+        time_tol  = get(base, "time_tolerance");
+    }
+    catch (const exception&)
+    {
+        if (!record)
+            throw;
+        // a new baseline, with the default bands
+    }
+    // the values of this build are `<case>.<value>@<build>`, the other builds' are kept as they are
+    const bool known = base.count(all.front().name + ".fom@" + build) > 0;
+    if (!known && !record)
+        cout << "no baseline for " << build << ", only the reproducibility is checked; add one with --record"
+             << endl;
+    map<string, string> kept;
+    for (const auto& kv : base)
+        if (kv.first.find('@') != string::npos && kv.first.substr(kv.first.find('@') + 1) != build)
+            kept.insert(kv);
+    ostringstream out;
+    out << "# de-regression baseline, rewrite the values of a build with `de-regression <this file> --record`\n"
+        << "fom_tolerance = " << fom_tol << "\nevals_tolerance = " << evals_tol
+        << "\ntime_tolerance = " << time_tol << "\n"
+        << setprecision(17);
+    for (const auto& kv : kept)
+        out << kv.first << " = " << kv.second << "\n";
+    size_t failures = 0;
+    cout << left << setw(18) << "case" << setw(14) << "fom" << setw(12) << "violation" << setw(10) << "evals"
+         << setw(10) << "gen cost" << "status" << endl;
+    for (const Case& c : all)
+    {
+        const Measure a = run(c);
+        // the fastest run, the others were more likely disturbed
+        double fastest = a.seconds_per_gen;
+        vector<string> errors, warnings;
+        for (size_t r = 1; r < timed_runs; ++r)
+        {
+            const Measure b = run(c);
+            fastest         = min(fastest, b.seconds_per_gen);
+            if ((a.best != b.best || a.fom != b.fom || a.evals_to_target != b.evals_to_target) && errors.empty())
+                errors.push_back("not reproducible");
+        }
+        const double gen_cost = fastest / unit;
+        const string suffix   = "@" + build;
+        if (!record && known)
+        {
+            const double fom       = get(base, c.name + ".fom" + suffix);
+            const double violation = get(base, c.name + ".violation" + suffix);
+            const double evals     = get(base, c.name + ".evals_to_target" + suffix);
+            const double cost      = get(base, c.name + ".gen_cost" + suffix);
+            if (!within(a.fom, fom, fom_tol) || !within(a.violation, violation, fom_tol))
+            {
+                ostringstream e;
+                e << "FOM " << a.fom << " violation " << a.violation << ", baseline " << fom << " " << violation;
+                errors.push_back(e.str());
+            }
+            if (evals > 0 && (a.evals_to_target == 0 || a.evals_to_target > evals * (1 + evals_tol)))
+                errors.push_back("evaluations to target " + to_string(a.evals_to_target) + " > " +
+                                 to_string(static_cast<size_t>(evals)));
+            if (gen_cost > cost * (1 + time_tol))
+            {
+                ostringstream e;
+                e << "generations " << setprecision(3) << gen_cost / cost << " times slower";
+                (strict_time ? errors : warnings).push_back(e.str());
+            }
+        }
+        out << c.name << ".fom" << suffix << " = " << a.fom << "\n"
+            << c.name << ".violation" << suffix << " = " << a.violation << "\n"
+            << c.name << ".evals_to_target" << suffix << " = " << a.evals_to_target << "\n"
+            << c.name << ".gen_cost" << suffix << " = " << gen_cost << "\n";
+        cout << setw(18) << c.name << setw(14) << a.fom << setw(12) << a.violation << setw(10)
+             << a.evals_to_target << setw(10) << setprecision(4) << gen_cost << setprecision(6);
+        failures += !errors.empty();
+        string status = !errors.empty() ? "FAIL: " : warnings.empty() ? "ok" : "warning: ";
+        errors.insert(errors.end(), warnings.begin(), warnings.end());
+        for (size_t k = 0; k < errors.size(); ++k)
+            status += (k ? "; " : "") + errors[k];
+        cout << status << endl;
+    }
+    if (record)
+    {
+        ofstream ofs(path);
+        if (!ofs || !(ofs << out.str()))
+            throw runtime_error("can't write " + path);
+        cout << "baseline written to " << path << endl;
+    }
+    cout << failures << " of " << all.size() << " cases failed" << endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
+int main(int argc, char** argv)
+{
+    try
+    {
+        return regression(argc, argv);
+    }
+    catch (const exception& e)
+    {
+        cerr << "de-regression: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,809 @@
+// de-tests: unit tests of the library (ctest targets `unit.<name>`)
+//
+//     de-tests <name>
+//
+// Every test throws on the first failed check, the exit status is non-zero then.
+#include "DifferentialEvolution.h"
+#include "global.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#if defined(__unix__) || defined(__APPLE__)
+#define DE_TESTS_POSIX
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+using namespace std;
+namespace
+{
+void check(bool ok, const string& what)
+{
+    if (!ok)
+        throw runtime_error("check failed: " + what);
+}
+
+// a subset batch records the durations of its individuals, the others keep their predictions
+void test_scheduler()
+{
+    EvalScheduler scheduler(LongestFirst);
+    scheduler.run(8, [](size_t i) { this_thread::sleep_for(chrono::milliseconds(1 + i)); });
+    const vector<double> before = scheduler.durations();
+    check(before.size() == 8, "one duration per individual");
+    for (size_t i = 1; i < 8; ++i)
+        check(before[i] > before[0], "durations follow the individuals");
+    const vector<size_t> which{6, 2};
+    vector<size_t> seen;
+    mutex m;
+    scheduler.run(which, [&](size_t k) {
+        lock_guard<mutex> lk(m);
+        seen.push_back(k);
+    });
+    check(seen.size() == 2 && seen[0] + seen[1] == 1, "eval gets the positions in the batch");
+    const vector<double>& after = scheduler.durations();
+    for (size_t i = 0; i < 8; ++i)
+    {
+        if (i == 2 || i == 6)
+            check(after[i] < before[0], "the evaluated individuals are updated");
+        else
+            check(after[i] == before[i], "the other individuals are untouched");
+    }
+    check(scheduler.evaluations() == 10, "evaluations are counted");
+    // the cached 0 .. n - 1 shrinks and grows with the batches
+    for (size_t n : {3, 5})
+    {
+        vector<char> hit(n, 0);
+        scheduler.run(n, [&](size_t i) { hit[i] = 1; });
+        check(count(hit.begin(), hit.end(), 1) == static_cast<long>(n), "every individual is evaluated once");
+    }
+}
+
+// user strategies overriding only the batch methods, which the solvers have to call
+struct BatchMutator : IMutator
+{
+    size_t calls = 0;
+    Solution mutation_solution(const DE& de, size_t i) { return de.population()[i]; }
+    vector<Solution> mutation(const DE& de)
+    {
+        ++calls;
+        return vector<Solution>(de.np(), Solution(de.dimension(), 1));
+    }
+};
+struct BatchCrossover : ICrossover
+{
+    size_t calls = 0;
+    Solution crossover_solution(const DE&, const Solution& target, const Solution&) { return target; }
+    vector<Solution> crossover(const DE&, const vector<Solution>&, const vector<Solution>& doners)
+    {
+        ++calls;
+        return doners;
+    }
+};
+void test_strategy()
+{
+    BatchMutator m;
+    BatchCrossover c;
+    Selector_FeasibilityRule s;
+    DE de([](size_t, const Solution& x) -> Evaluated { return {fabs(x[0] - 1) + fabs(x[1] - 1), {}}; },
+          Ranges(2, {-5, 5}), &m, &c, &s, 0.5, 0.9, 10, 5, {{"seed", 1}});
+    de.set_log(nullptr);
+    const Solution best = de.solver();
+    check(m.calls == 4 && c.calls == 4, "the batch methods are called once per generation");
+    check(best == Solution(2, 1), "the batch donors are used");
+}
+
+// the runs surviving the checkpoint of a sweep are resumed: their curves, bests and evaluations
+// are those of the same sweep without early stopping
+void test_sweep()
+{
+    atomic<size_t> calls(0);
+    auto sphere = [&](size_t, const Solution& x) -> Evaluated {
+        ++calls;
+        double f = 0;
+        for (Scalar v : x)
+            f += (v - 1) * (v - 1);
+        return {f, {}};
+    };
+    SweepConfig base;
+    base.np       = 8;
+    base.max_iter = 20;
+    const vector<SweepConfig> configs = Sweep::grid(base, {Rand1, Best1}, {Bin, Exp}, {0.5, 0.9}, {0.9}, {1});
+    Sweep full(sphere, Ranges(4, {-5, 5})), stopped(sphere, Ranges(4, {-5, 5}));
+    for (const auto& c : configs)
+    {
+        full.add(c);
+        stopped.add(c);
+    }
+    stopped.set_early_stop(5, 0.5, 4);
+    full.run();
+    calls = 0;
+    stopped.run();
+    size_t survivors = 0, evaluations = 0;
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        const SweepResult& a = full.results()[i];
+        const SweepResult& b = stopped.results()[i];
+        evaluations += b.evaluations;
+        if (b.stopped_early)
+        {
+            check(b.generations == 6 && b.evaluations == 6 * base.np, "a hopeless run stops at the checkpoint");
+            continue;
+        }
+        ++survivors;
+        check(b.curve == a.curve && b.best == a.best, "a resumed run goes on as if it hadn't stopped");
+        check(b.evaluations == a.evaluations && b.generations == a.generations, "both passes are counted");
+    }
+    check(survivors > 0 && survivors < configs.size(), "some runs are stopped early");
+    check(calls == evaluations, "no generation is evaluated twice");
+}
+
+// the covariance of the eigen crossover follows the selection by Welford updates, after every
+// generation it matches the mean and scatter recomputed from the population
+void test_eigen()
+{
+    const size_t dim = 6;
+    Mutator_Rand_1 m;
+    Crossover_Eigen c(3, 1);
+    Selector_FeasibilityRule s;
+    size_t checked = 0;
+    DE de([](size_t, const Solution& x) -> Evaluated {
+        double f = 0;
+        for (size_t j = 0; j < x.size(); ++j)
+            f += (j + 1) * (x[j] - 0.5 * x[0]) * (x[j] - 0.5 * x[0]); // correlated, ill-conditioned
+        return {f, {}};
+    }, Ranges(dim, {-5, 5}), &m, &c, &s, 0.5, 0.9, 12, 50, {{"seed", 6}});
+    de.set_log(nullptr);
+    de.set_generation_callback([&](const DE& d) -> bool {
+        const vector<Solution>& pop = d.population();
+        const double n = static_cast<double>(pop.size());
+        vector<double> mean(dim, 0), scatter(dim * dim, 0);
+        for (const Solution& x : pop)
+            for (size_t a = 0; a < dim; ++a)
+                mean[a] += x[a] / n;
+        for (const Solution& x : pop)
+            for (size_t a = 0; a < dim; ++a)
+                for (size_t b = 0; b < dim; ++b)
+                    scatter[a * dim + b] += (x[a] - mean[a]) * (x[b] - mean[b]);
+        double scale = 0;
+        for (double v : scatter)
+            scale = max(scale, fabs(v));
+        check(c.mean().size() == dim && c.scatter().size() == dim * dim, "the covariance is sized");
+        for (size_t a = 0; a < dim; ++a)
+            check(fabs(c.mean()[a] - mean[a]) <= 1e-9 * (1 + fabs(mean[a])), "the mean follows the population");
+        for (size_t k = 0; k < dim * dim; ++k)
+            check(fabs(c.scatter()[k] - scatter[k]) <= 1e-9 * scale, "the scatter follows the population");
+        ++checked;
+        return true;
+    });
+    de.solver();
+    check(checked == 49 && c.refreshes() > 0, "every generation is checked with the eigenbasis in use");
+}
+
+// a selector remembering its last verdict for every trial
+struct VerdictSelector : Selector_FeasibilityRule
+{
+    vector<char> verdict;
+    size_t rejected = 0;
+    bool can_win(const DE& de, const ConstraintViolation& vio, const Evaluated& target)
+    {
+        const bool win = Selector_FeasibilityRule::can_win(de, vio, target);
+        // the trial is found by its target, whose result is passed by reference
+        verdict[static_cast<size_t>(&target - de.evaluated().data())] = win;
+        rejected += win ? 0 : 1;
+        return win;
+    }
+};
+// the figure of merit of a staged run is never computed for a trial that `can_win` rejected, and
+// only the skipped ones are missing from the figure of merit calls
+void test_staged()
+{
+    const size_t np = 10, max_iter = 40;
+    Mutator_Rand_1 m;
+    Crossover_Bin c;
+    VerdictSelector s;
+    s.verdict.assign(np, 1); // the initial population always gets both stages
+    atomic<size_t> fom_calls(0), rejected_calls(0);
+    auto constraints = [](size_t, const Solution& x) -> ConstraintViolation {
+        return {max(0.0, static_cast<double>(x[0] + x[1]))};
+    };
+    auto fom = [&](size_t i, const Solution& x) -> double {
+        ++fom_calls;
+        rejected_calls += s.verdict[i] ? 0 : 1;
+        return (x[0] - 1) * (x[0] - 1) + (x[1] - 1) * (x[1] - 1);
+    };
+    DE de([&](size_t i, const Solution& x) -> Evaluated { return {fom(i, x), constraints(i, x)}; },
+          Ranges(2, {-5, 5}), &m, &c, &s, 0.5, 0.9, np, max_iter, {{"seed", 2}});
+    de.set_log(nullptr);
+    de.set_staged_objective(constraints, fom);
+    de.solver();
+    const StagedStats& st = de.staged_stats();
+    check(s.rejected > 0 && st.skipped == s.rejected, "the rejected trials are skipped");
+    check(rejected_calls == 0, "no figure of merit is computed for a rejected trial");
+    check(fom_calls == np + st.trials - st.skipped, "every other trial gets its figure of merit");
+    const Evaluated& best = de.evaluated()[de.find_best()];
+    check(best.second[0] == 0 && best.first < 2.5, "the staged run converges to the boundary");
+}
+
+// the geometric skips of the sparse binomial crossover pick every coordinate with probability CR,
+// plus the forced one: CR * (dim - 1) + 1 positions on average, ascending and spread evenly
+void test_sparse()
+{
+    const size_t dim = 1000, samples = 2000;
+    for (double cr : {0.0, 0.01, 0.1, 0.5, 1.0})
+    {
+        DEConfig conf;
+        conf.cs = SparseBin;
+        conf.cr = cr;
+        DE de([](size_t, const Solution&) -> Evaluated { return {0, {}}; }, Ranges(dim, {0, 1}), conf);
+        Crossover_SparseBin crossover;
+        SparseTrial trial;
+        engine.seed(11);
+        double total = 0, first = 0, last = 0;
+        for (size_t n = 0; n < samples; ++n)
+        {
+            crossover.sample_positions(de, 3, trial);
+            check(trial.target == 3 && !trial.index.empty(), "the trial belongs to its target");
+            for (size_t k = 0; k < trial.index.size(); ++k)
+                check(trial.index[k] < dim && (k == 0 || trial.index[k - 1] < trial.index[k]),
+                      "the positions are ascending and in range");
+            total += static_cast<double>(trial.index.size());
+            first += trial.index.front() == 0 ? 1 : 0;
+            last += trial.index.back() == dim - 1 ? 1 : 0;
+        }
+        const double mean = total / samples, expected = cr * (dim - 1) + 1;
+        check(fabs(mean - expected) < 1 + 0.01 * expected, "the mean count is CR * (dim - 1) + 1");
+        check(fabs(first / samples - cr) < 0.03 && fabs(last / samples - cr) < 0.03,
+              "the first and the last coordinates are picked with probability CR");
+    }
+}
+
+// a linear constraint has an exact Jacobian, one Newton-like step moves an infeasible trial onto its
+// boundary; feasible trials are left alone
+void test_repair()
+{
+    auto objective = [](size_t, const Solution& x) -> Evaluated {
+        return {x[0] * x[0] + x[1] * x[1], {max(0.0, static_cast<double>(x[0] + 2 * x[1]) - 1)}};
+    };
+    auto evaluator = [&](const vector<Solution>& xs, const vector<size_t>&, vector<Evaluated>& results) {
+        for (size_t k = 0; k < xs.size(); ++k)
+            results[k] = objective(k, xs[k]);
+    };
+    DEConfig conf;
+    DE de(objective, Ranges(2, {-5, 5}), conf);
+    vector<Solution> trials{Solution{3, 3}, Solution{0, 0}, Solution{-2, 4}};
+    vector<Evaluated> results(trials.size());
+    evaluator(trials, {}, results);
+    const vector<Solution> before(trials);
+    GradientRepair repair(1, 3);
+    repair.repair(de, evaluator, evaluator, trials, results);
+    const RepairStats& st = repair.stats();
+    check(st.attempted == 2 && st.improved == 2, "both infeasible trials are repaired");
+    check(st.violation_before == 8 + 5 && st.violation_after < 1e-6, "the violation drops to the boundary");
+    check(trials[1] == before[1] && results[1] == objective(1, before[1]), "a feasible trial is untouched");
+    for (size_t i : {0, 2})
+    {
+        check(results[i] == objective(i, trials[i]), "the results follow the repaired trials");
+        check(results[i].second[0] < 1e-6, "the repaired trial is on the boundary");
+    }
+}
+
+// the k-NN surrogate reproduces the archived points and interpolates between them, and a screened
+// run truly evaluates only the trials the surrogate lets through, which win more often than the others
+void test_surrogate()
+{
+    Surrogate_KNN knn(2);
+    const vector<Solution> xs{Solution{0, 0}, Solution{1, 0}, Solution{0, 1}};
+    const vector<Evaluated> ys{{0, {}}, {2, {1}}, {4, {0.5, 0.5}}};
+    knn.fit(xs, ys);
+    check(knn.predict(xs[1]) == Evaluated(2, {1}), "an archived point is predicted exactly");
+    const Evaluated mid = knn.predict(Solution{0.5, 0});
+    check(mid.first == 1 && mid.second == ConstraintViolation{0.5}, "the nearest points are averaged");
+
+    DEConfig conf;
+    conf.np                = 10;
+    conf.max_iter          = 60;
+    conf.seeded            = true;
+    conf.surrogate.enabled = true;
+    conf.surrogate.explore = 0.1;
+    atomic<size_t> calls(0);
+    DE de([&](size_t, const Solution& x) -> Evaluated {
+        ++calls;
+        double f = 0;
+        for (Scalar v : x)
+            f += (v - 1) * (v - 1);
+        return {f, {}};
+    }, Ranges(4, {-5, 5}), conf);
+    de.set_log(nullptr);
+    de.solver();
+    const SurrogateStats& ss = de.surrogate()->stats();
+    check(ss.screened > 0 && ss.skipped > 0, "the surrogate saves evaluations");
+    check(calls + ss.skipped == conf.np * conf.max_iter, "the skipped trials are not evaluated");
+    check(ss.predicted_win + ss.explored + ss.skipped == ss.screened, "every screened trial is accounted for");
+    const double explored_rate = ss.explored == 0 ? 0 : static_cast<double>(ss.explored_win) / ss.explored;
+    check(ss.precision() > explored_rate, "the predicted winners win more often than the explored trials");
+}
+
+// IPOP restarts on a multimodal function: NP grows by `growth` from run to run, and the runs
+// together never spend more than the shared budget
+void test_restart()
+{
+    DEConfig conf;
+    conf.np                   = 8;
+    conf.max_iter             = 500;
+    conf.seeded               = true;
+    conf.seed                 = 4;
+    conf.restart.max_restarts = 10;
+    conf.restart.growth       = 2;
+    conf.restart.stall        = 10;
+    conf.restart.budget       = 3333;
+    atomic<size_t> calls(0);
+    DE de([&](size_t, const Solution& x) -> Evaluated {
+        ++calls;
+        double f = 0;
+        for (Scalar v : x)
+            f += v * v - 10 * cos(2 * M_PI * v) + 10;
+        return {f, {}};
+    }, Ranges(5, {-5.12, 5.12}), conf);
+    de.set_log(nullptr);
+    RestartController restarts(de);
+    restarts.solver();
+    const vector<RestartRun>& runs = restarts.runs();
+    check(runs.size() > 2, "the stalled runs are restarted");
+    for (size_t r = 1; r < runs.size(); ++r)
+        check(runs[r].np == 2 * runs[r - 1].np, "NP grows by the growth factor");
+    size_t spent = 0;
+    for (const auto& run : runs)
+        spent += run.evaluations;
+    check(calls == restarts.evaluations() && spent == calls, "every evaluation is counted once");
+    check(calls <= conf.restart.budget, "the runs stay within the shared budget");
+    check(calls + runs.back().np * 2 > conf.restart.budget || runs.size() == conf.restart.max_restarts + 1,
+          "the restarts go on until the next initial population doesn't fit");
+}
+
+// objective indices being evaluated, and those evaluated twice at the same time
+struct InFlight
+{
+    mutex m;
+    vector<char> busy;
+    size_t overlaps = 0, largest = 0;
+    double sphere(size_t i, const Solution& x)
+    {
+        {
+            lock_guard<mutex> lk(m);
+            if (busy.size() <= i)
+                busy.resize(i + 1, 0);
+            overlaps += busy[i];
+            busy[i] = 1;
+            largest = max(largest, i);
+        }
+        this_thread::sleep_for(chrono::microseconds(50));
+        double f = 0;
+        for (Scalar v : x)
+            f += v * v;
+        lock_guard<mutex> lk(m);
+        busy[i] = 0;
+        return f;
+    }
+};
+
+// the sub-populations of a coevolution and the grouping probes run concurrently, an objective index
+// is never evaluated twice at the same time and stays below `slots()`
+void test_coevolution()
+{
+    DEConfig conf;
+    conf.np                      = 8;
+    conf.seeded                  = true;
+    conf.seed                    = 5;
+    conf.coevolution.grouping    = DifferentialGrouping;
+    conf.coevolution.group_size  = 5;
+    conf.coevolution.cycles      = 3;
+    conf.coevolution.generations = 5;
+    InFlight flight;
+    Coevolution cc([&](size_t i, const Solution& x) -> Evaluated { return {flight.sphere(i, x), {}}; },
+                   Ranges(20, {-5, 5}), conf);
+    cc.set_log(nullptr);
+    cc.solver();
+    check(cc.groups().size() == 4, "the separable variables are packed into groups");
+    check(flight.overlaps == 0, "no index is evaluated twice at the same time");
+    check(flight.largest < cc.slots(), "the indices stay below slots()");
+}
+
+// local search jobs evaluate concurrently with the population on indices of their own
+void test_localsearch()
+{
+    DEConfig conf;
+    conf.np                   = 8;
+    conf.max_iter             = 40;
+    conf.seeded               = true;
+    conf.local_search.enabled = true;
+    conf.local_search.period  = 2;
+    conf.local_search.top_k   = 3;
+    conf.local_search.share   = 0.5;
+    InFlight flight;
+    DE de([&](size_t i, const Solution& x) -> Evaluated { return {flight.sphere(i, x), {}}; },
+          Ranges(3, {-5, 5}), conf);
+    de.set_log(nullptr);
+    de.solver();
+    check(de.local_search()->stats().evaluations > 0, "local search ran");
+    check(flight.largest >= conf.np && flight.largest < de.slots(), "local search uses the indices NP ..");
+    check(flight.overlaps == 0, "no index is evaluated twice at the same time");
+}
+
+// with a multi-fidelity objective only the promoted trials reach the high fidelity, and only those
+// are recorded by the surrogate: the others hold their targets and teach it nothing
+void test_fidelity()
+{
+    DEConfig conf;
+    conf.np                    = 10;
+    conf.max_iter              = 30;
+    conf.seeded                = true;
+    conf.seed                  = 3;
+    conf.fidelity.promotion    = PromoteTop;
+    conf.fidelity.top_fraction = 0.2;
+    conf.surrogate.enabled     = true;
+    conf.surrogate.min_archive = 10; // the initial population, every generation is screened
+    atomic<size_t> high_calls(0);
+    auto sphere = [](const Solution& x) {
+        double f = 0;
+        for (Scalar v : x)
+            f += (v - 1) * (v - 1);
+        return f;
+    };
+    DE de([&](size_t, const Solution& x) -> Evaluated {
+        ++high_calls;
+        return {sphere(x), {}};
+    }, Ranges(3, {-5, 5}), conf);
+    de.set_log(nullptr);
+    de.set_multi_fidelity_objective([&](size_t, const Solution& x) -> Evaluated { return {sphere(x) + 0.1 * x[0], {}}; },
+                                    [&](size_t, const Solution& x) -> Evaluated {
+                                        ++high_calls;
+                                        return {sphere(x), {}};
+                                    });
+    de.solver();
+    const FidelityStats fs   = de.fidelity_stats();
+    const SurrogateStats& ss = de.surrogate()->stats();
+    check(fs.promoted > 0 && fs.promoted < fs.trials, "a part of the trials is promoted");
+    check(high_calls == conf.np + fs.promoted, "only the promoted trials are evaluated at high fidelity");
+    check(ss.screened > 0, "the surrogate screens trials");
+    check(ss.predicted_win + ss.explored == fs.promoted, "only the promoted trials are recorded");
+}
+
+// a lone problem is lane 0 of block 0, whose engine is seeded with seed + 0x9E3779B97F4A7C15: a scalar
+// best1/bin DE with the feasibility rule replaying the draws of BatchDE has to find the same best,
+// and the padding lanes of a partial block never reach the objective and stay at 0
+void batch_objective(size_t count, const Scalar* xs, size_t stride, size_t dim, double* fom, double* violation)
+{
+    for (size_t l = 0; l < count; ++l)
+    {
+        double f = 0;
+        for (size_t j = 0; j < dim; ++j)
+            f += (xs[j * stride + l] - 0.3) * (xs[j * stride + l] - 0.3);
+        fom[l]       = f;
+        violation[l] = max(0.0, static_cast<double>(xs[l] + xs[stride + l]) - 0.4);
+    }
+}
+void test_batchde()
+{
+    DEConfig conf;
+    conf.ms       = Best1;
+    conf.cs       = Bin;
+    conf.ss       = FeasibilityRule;
+    conf.np       = 6; // the shared difference often hits the best
+    conf.max_iter = 60;
+    conf.seeded   = true;
+    conf.seed     = 7;
+    const size_t dim = 3;
+    const Ranges ranges(dim, {-1, 1});
+    BatchDE batch([&](size_t, size_t count, const Scalar* xs, size_t stride, double* fom, double* violation) {
+        batch_objective(count, xs, stride, dim, fom, violation);
+    }, 1, ranges, conf);
+    batch.solver();
+
+    mt19937_64 eng(conf.seed + 0x9E3779B97F4A7C15ULL);
+    const size_t np = conf.np;
+    vector<Solution> x(np, Solution(dim)), t(np, Solution(dim));
+    vector<double> fom(np), vio(np), tfom(np), tvio(np);
+    auto evaluate = [&](const vector<Solution>& xs, vector<double>& f, vector<double>& v) {
+        for (size_t i = 0; i < np; ++i)
+            batch_objective(1, xs[i].data(), 1, dim, &f[i], &v[i]);
+    };
+    auto better = [](double f1, double v1, double f2, double v2) { return v1 < v2 || (v1 == v2 && f1 <= f2); };
+    auto find_best = [&]() {
+        size_t best = 0;
+        for (size_t i = 1; i < np; ++i)
+            if (!better(fom[best], vio[best], fom[i], vio[i]))
+                best = i;
+        return best;
+    };
+    for (size_t i = 0; i < np; ++i)
+        for (size_t j = 0; j < dim; ++j)
+            x[i][j] = static_cast<Scalar>(uniform_real_distribution<double>(-1, 1)(eng));
+    evaluate(x, fom, vio);
+    size_t best = find_best();
+    uniform_int_distribution<size_t> i_distr(0, np - 1), j_distr(0, dim - 1);
+    uniform_real_distribution<double> prob(0, 1);
+    const Scalar f = static_cast<Scalar>(conf.f);
+    for (size_t g = 1; g < conf.max_iter; ++g)
+    {
+        const Solution base = x[best];
+        for (size_t i = 0; i < np; ++i)
+        {
+            size_t r1 = i_distr(eng), r2;
+            do
+                r2 = i_distr(eng);
+            while (r2 == r1);
+            if (r1 == best || r2 == best)
+            {
+                do
+                    r1 = i_distr(eng);
+                while (r1 == best);
+                do
+                    r2 = i_distr(eng);
+                while (r2 == best || r2 == r1);
+            }
+            const size_t rand_idx = j_distr(eng);
+            vector<char> mask(dim);
+            for (size_t j = 0; j < dim; ++j)
+                mask[j] = prob(eng) <= conf.cr || j == rand_idx;
+            for (size_t j = 0; j < dim; ++j)
+            {
+                t[i][j] = mask[j] ? base[j] + f * (x[r1][j] - x[r2][j]) : x[i][j];
+                if (mask[j] && !(-1 <= t[i][j] && t[i][j] <= 1))
+                    t[i][j] = static_cast<Scalar>(uniform_real_distribution<double>(-1, 1)(eng));
+            }
+        }
+        evaluate(t, tfom, tvio);
+        for (size_t i = 0; i < np; ++i)
+        {
+            if (better(tfom[i], tvio[i], fom[i], vio[i]))
+            {
+                x[i]   = t[i];
+                fom[i] = tfom[i];
+                vio[i] = tvio[i];
+            }
+        }
+        best = find_best();
+    }
+    check(batch.best(0) == x[best], "the lane follows the scalar DE with the same draws");
+    check(batch.best_fom(0) == fom[best] && batch.best_violation(0) == vio[best], "same best result");
+
+    const size_t n = 3;
+    bool inert = true;
+    BatchDE partial([&](size_t begin, size_t count, const Scalar* xs, size_t stride, double* fom, double* violation) {
+        inert = inert && begin == 0 && count == n;
+        for (size_t j = 0; j < dim; ++j)
+            for (size_t l = n; l < stride; ++l)
+                inert = inert && xs[j * stride + l] == 0;
+        batch_objective(count, xs, stride, dim, fom, violation);
+    }, n, ranges, conf);
+    partial.solver();
+    check(inert, "the padding lanes stay at 0 and never reach the objective");
+    check(partial.evaluations() == n * conf.np * conf.max_iter, "only the problems are counted");
+}
+
+#ifdef DE_TESTS_POSIX
+// the file format of EvalCache: a 32-byte header, then records of a 32-byte header (size, checksum
+// of the record from the key on, key, scope, dim, number of constraints), the quantized coordinates
+// and the values
+const size_t cache_header = 32;
+size_t cache_record(size_t dim, size_t num_constraints)
+{
+    return 32 + 8 * dim + 8 * (1 + num_constraints);
+}
+string read_file(const string& path)
+{
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+void write_file(const string& path, const string& bytes)
+{
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+}
+uint32_t cache_checksum(const char* record, size_t size)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 8; i < size; ++i)
+    {
+        h ^= static_cast<unsigned char>(record[i]);
+        h *= 1099511628211ULL;
+    }
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+Solution point2(double x, double y)
+{
+    return Solution{static_cast<Scalar>(x), static_cast<Scalar>(y)};
+}
+bool cached(EvalCache& cache, const Solution& x, double fom)
+{
+    Evaluated r;
+    return cache.find(x, r) && r.first == fom;
+}
+
+// a torn tail is ignored and overwritten, concurrent writers through flock never interleave
+// their records, and a record of another point under the same key is never returned
+void test_cache()
+{
+    const string path = "de_tests_cache.bin";
+    const Ranges ranges(2, {0, 1});
+    const size_t rec = cache_record(2, 0);
+    const Solution a = point2(0.1, 0.2), b = point2(0.3, 0.4), c = point2(0.5, 0.6);
+    remove(path.c_str());
+    {
+        EvalCache cache(path, "test", ranges);
+        cache.insert(a, {1, {}});
+        cache.insert(b, {2, {}});
+    }
+    check(read_file(path).size() == cache_header + 2 * rec, "two records are appended");
+    check(truncate(path.c_str(), static_cast<off_t>(cache_header + 2 * rec - rec / 2)) == 0, "truncate");
+    {
+        EvalCache cache(path, "test", ranges);
+        check(cache.records() == 1, "the torn record is ignored");
+        check(cached(cache, a, 1) && !cached(cache, b, 2), "the complete record is still found");
+        cache.insert(c, {3, {}});
+    }
+    check(read_file(path).size() == cache_header + 2 * rec, "the next append overwrites the torn tail");
+    {
+        EvalCache cache(path, "test", ranges);
+        check(cache.records() == 2 && cached(cache, a, 1) && cached(cache, c, 3), "the overwritten tail is valid");
+    }
+
+    // two handles on the same file, like two processes, appending concurrently
+    remove(path.c_str());
+    const size_t n = 200;
+    auto point     = [](size_t k) { return point2(static_cast<double>(k) / 1000, 0.5); };
+    {
+        EvalCache first(path, "test", ranges), second(path, "test", ranges);
+        thread writer([&]() {
+            for (size_t k = 0; k < n; k += 2)
+                first.insert(point(k), {static_cast<double>(k), {}});
+        });
+        for (size_t k = 1; k < n; k += 2)
+            second.insert(point(k), {static_cast<double>(k), {}});
+        writer.join();
+    }
+    check(read_file(path).size() == cache_header + n * rec, "no record is lost or overwritten");
+    {
+        EvalCache cache(path, "test", ranges);
+        check(cache.records() == n, "every record is valid");
+        for (size_t k = 0; k < n; ++k)
+            check(cached(cache, point(k), static_cast<double>(k)), "every point is found");
+    }
+
+    // forge a record of b under the key of a, a lookup of a has to skip it
+    remove(path.c_str());
+    {
+        EvalCache cache(path, "test", ranges);
+        cache.insert(a, {1, {}});
+        cache.insert(b, {2, {}});
+    }
+    const string bytes = read_file(path);
+    string forged      = bytes.substr(cache_header, rec);
+    const double bogus = 99;
+    forged.replace(32, 16, bytes.substr(cache_header + rec + 32, 16)); // coordinates of b
+    memcpy(&forged[48], &bogus, sizeof(bogus));
+    const uint32_t sum = cache_checksum(forged.data(), rec);
+    memcpy(&forged[4], &sum, sizeof(sum));
+    write_file(path, bytes.substr(0, cache_header) + forged);
+    {
+        EvalCache cache(path, "test", ranges);
+        check(cache.records() == 1, "the forged record is valid");
+        Evaluated r;
+        check(!cache.find(a, r) && !cache.find(b, r), "a hash collision is not a hit");
+        cache.insert(a, {1, {}});
+        check(cached(cache, a, 1), "the point is stored beside the colliding record");
+        EvalCache other(path, "other", ranges);
+        check(!other.find(a, r), "another tag doesn't match");
+        check(!cache.find(a, r, 1), "another objective doesn't match");
+    }
+    remove(path.c_str());
+}
+
+// the exposition of a finished run, served while a silent client and a client stuck in the
+// middle of its request hold their connections
+void test_metrics()
+{
+    const string path = "de_tests_metrics.sock";
+    DEConfig conf;
+    conf.np       = 8;
+    conf.max_iter = 5;
+    conf.seeded   = true;
+    DE de([](size_t, const Solution& x) -> Evaluated { return {x[0] * x[0] + x[1] * x[1], {1}}; },
+          Ranges(2, {-1, 1}), conf);
+    de.set_log(nullptr);
+    de.solver();
+    MetricsServer server("unix:" + path);
+    server.add("a\"b", de.metrics());
+    auto connect_client = [&](const char* request) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        check(fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "connected");
+        check(send(fd, request, strlen(request), 0) == static_cast<ssize_t>(strlen(request)), "sent");
+        return fd;
+    };
+    const int stuck  = connect_client("GET /met");
+    const int silent = connect_client("");
+    const auto t0     = chrono::steady_clock::now();
+    const string text = MetricsServer::fetch(server.address());
+    const double dt   = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    check(dt < 0.5, "a stuck client doesn't delay the scrape");
+    for (const char* line : {"# TYPE de_evaluations_total counter\n", "de_evaluations_total{run=\"a\\\"b\"} 40\n",
+                             "# TYPE de_generation gauge\n", "de_generation{run=\"a\\\"b\"} 4\n",
+                             "de_running{run=\"a\\\"b\"} 0\n", "de_best_violation{run=\"a\\\"b\"} 1\n"})
+        check(text.find(line) != string::npos, string("exposed: ") + line);
+    string raw;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(silent, buf, sizeof(buf), 0)) > 0)
+        raw.append(buf, static_cast<size_t>(n));
+    check(raw == text, "a silent client gets the text");
+    close(silent);
+    close(stuck);
+}
+#endif
+
+const map<string, function<void()>>& tests()
+{
+    static const map<string, function<void()>> all{
+#ifdef DE_TESTS_POSIX
+        {"cache", test_cache},
+        {"metrics", test_metrics},
+#endif
+        {"batchde", test_batchde},
+        {"coevolution", test_coevolution},
+        {"eigen", test_eigen},
+        {"fidelity", test_fidelity},
+        {"localsearch", test_localsearch},
+        {"repair", test_repair},
+        {"restart", test_restart},
+        {"scheduler", test_scheduler},
+        {"sparse", test_sparse},
+        {"staged", test_staged},
+        {"strategy", test_strategy},
+        {"surrogate", test_surrogate},
+        {"sweep", test_sweep},
+    };
+    return all;
+}
+}
+int main(int argc, char** argv)
+{
+    if (argc != 2 || !tests().count(argv[1]))
+    {
+        cerr << "usage: de-tests <name>, names:";
+        for (const auto& t : tests())
+            cerr << " " << t.first;
+        cerr << endl;
+        return EXIT_FAILURE;
+    }
+    try
+    {
+        tests().at(argv[1])();
+    }
+    catch (const exception& e)
+    {
+        cerr << argv[1] << ": " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    cout << argv[1] << ": ok" << endl;
+    return EXIT_SUCCESS;
+}